@@ -0,0 +1,47 @@
+#pragma once
+
+#include <algorithm>
+
+#include "ospray/ospray_cpp.h"
+
+#include "trace.h"
+
+// Whether the view accumulated in framebuffer over `launches` renderFrame()
+// calls has converged: with a variance_threshold above 0, once OSPRay's
+// variance estimate drops below it. The estimate compares two halves of the
+// accumulated samples, so it is meaningless before the second launch. Needs
+// a framebuffer created with OSP_FB_VARIANCE.
+inline bool view_converged(ospray::cpp::FrameBuffer &framebuffer,
+                           const int launches,
+                           const float variance_threshold)
+{
+  const int min_launches = 2;
+  return variance_threshold > 0.f && launches >= min_launches
+      && framebuffer.variance() < variance_threshold;
+}
+
+// Accumulates frames of one view into framebuffer and returns the number of
+// frames rendered. With a variance_threshold of 0 exactly max_frames are
+// rendered, as before. Otherwise rendering stops early once the view
+// converged, see view_converged(). Every frame is traced from its submission
+// to its completion.
+int accumulateFrames(ospray::cpp::FrameBuffer &framebuffer,
+                     ospray::cpp::Renderer &renderer,
+                     ospray::cpp::Camera &camera,
+                     ospray::cpp::World &world,
+                     const int max_frames,
+                     const float variance_threshold)
+{
+  TraceScope scope("accumulate_view");
+  int frames = 0;
+  while (frames < std::max(max_frames, 1)) {
+    const Tracer::clock::time_point submitted = Tracer::clock::now();
+    framebuffer.renderFrame(renderer, camera, world).wait();
+    Tracer::instance().record("frame", submitted, Tracer::clock::now());
+    ++frames;
+    if (view_converged(framebuffer, frames, variance_threshold)) {
+      break;
+    }
+  }
+  return frames;
+}
@@ -0,0 +1,312 @@
+// Standard benchmark scenarios on a synthetic volume, for tracking
+// performance across versions without simulation data:
+//
+//   generate     synthesize the volume
+//   load         load_raw_volume() of the raw file, computing its stats
+//                (the stats cache is not written)
+//   load_cached  load_raw_volume() with the stats cache present
+//   load_mmap    as load_cached, mapping the file instead of reading it and
+//                then touching every page of the mapping
+//   range        compute_stats() of the in-memory volume
+//   scene_build  VolumeScene construction
+//   swap_volume  VolumeScene::setVolume()
+//   render       renderViews() of orbit views at a fixed frame count
+//   encode_jpg   JPG encode and write of rendered images by an ImageWriter
+//                (its threads are started before the timing)
+//   encode_png   the same as PNG
+//
+// The raw file was just written, so loads measure the page cache rather than
+// the disk. Every scenario runs -repeats times; the results are written as
+// JSON to -o (bench_results.json by default).
+//
+// -dims takes one size for a cube or XxYxZ, -image, -views, -frames and
+// -repeats must be positive.
+//
+//   bench [-field marschner-lobb|noise|gradient|sphere] [-dims 256|XxYxZ]
+//         [-voxel-type float32] [-image 256] [-views 64] [-frames 8]
+//         [-repeats 5] [-work-dir .] [-o bench_results.json]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "ospray/ospray_cpp.h"
+#include "ospray/ospray_cpp/ext/rkcommon.h"
+
+using namespace rkcommon::math;
+
+#include "load_raw.h"
+#include "synthetic_volume.h"
+#include "volume_scene.h"
+#include "view_scheduler.h"
+#include "image_writer.h"
+#include "camera_gen.h"
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h"
+
+struct BenchConfig
+{
+    std::string field = "marschner-lobb";
+    vec3i dims{256, 256, 256};
+    std::string voxel_type = "float32";
+    int image = 256;
+    int views = 64;
+    int frames = 8;
+    int repeats = 5;
+    std::string work_dir = ".";
+    std::string output = "bench_results.json";
+};
+
+struct BenchResult
+{
+    std::string scenario;
+    // amount of work per run and its unit, for the throughput
+    double items = 0.0;
+    std::string unit;
+    std::vector<double> seconds;
+};
+
+double median(std::vector<double> v)
+{
+    std::sort(v.begin(), v.end());
+    const size_t n = v.size();
+    return n % 2 ? v[n / 2] : 0.5 * (v[n / 2 - 1] + v[n / 2]);
+}
+
+// reads one byte of every page of the voxels, so a mapped volume is actually
+// paged in rather than only mapped
+uint64_t touch_pages(const Volume &volume)
+{
+    const size_t page = 4096;
+    const uint8_t *data = reinterpret_cast<const uint8_t *>(volume.data());
+    uint64_t sum = 0;
+    for (size_t i = 0; i < volume.n_bytes(); i += page) {
+        sum += data[i];
+    }
+    return sum;
+}
+
+// runs setup (untimed) and then run, repeats times
+BenchResult run_scenario(const BenchConfig &config,
+                         const std::string &scenario,
+                         const double items,
+                         const std::string &unit,
+                         const std::function<void()> &setup,
+                         const std::function<void()> &run)
+{
+    BenchResult result;
+    result.scenario = scenario;
+    result.items = items;
+    result.unit = unit;
+    for (int r = 0; r < config.repeats; ++r) {
+        if (setup) {
+            setup();
+        }
+        const auto start = std::chrono::steady_clock::now();
+        run();
+        const auto end = std::chrono::steady_clock::now();
+        result.seconds.push_back(std::chrono::duration<double>(end - start).count());
+    }
+    std::cerr << scenario << ": " << median(result.seconds) * 1e3 << " ms median, "
+              << items / median(result.seconds) << " " << unit << std::endl;
+    return result;
+}
+
+// s as a quoted JSON string
+std::string json_string(const std::string &s)
+{
+    std::string out = "\"";
+    for (const char c : s) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out += escaped;
+        } else {
+            out += c;
+        }
+    }
+    return out + "\"";
+}
+
+void write_json(std::ostream &os, const BenchConfig &config, const std::vector<BenchResult> &results)
+{
+    os << "{\n";
+    os << "  \"benchmark\": \"osp-gen-images\",\n";
+    os << "  \"config\": {\"field\": " << json_string(config.field) << ", \"dims\": ["
+       << config.dims.x << ", " << config.dims.y << ", " << config.dims.z
+       << "], \"voxel_type\": " << json_string(config.voxel_type) << ", \"image\": " << config.image
+       << ", \"views\": " << config.views << ", \"frames\": " << config.frames
+       << ", \"repeats\": " << config.repeats
+       << ", \"hardware_threads\": " << std::thread::hardware_concurrency() << "},\n";
+    os << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult &r = results[i];
+        const double med = median(r.seconds);
+        os << "    {\"scenario\": " << json_string(r.scenario) << ", \"median_s\": " << med
+           << ", \"min_s\": " << *std::min_element(r.seconds.begin(), r.seconds.end())
+           << ", \"max_s\": " << *std::max_element(r.seconds.begin(), r.seconds.end())
+           << ", \"throughput\": " << r.items / med << ", \"unit\": " << json_string(r.unit) << "}"
+           << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    os << "  ]\n}\n";
+}
+
+// N for an N^3 volume or XxYxZ, all positive
+bool parse_dims(const char *arg, vec3i &dims)
+{
+    int used = 0;
+    if (std::sscanf(arg, "%dx%dx%d%n", &dims.x, &dims.y, &dims.z, &used) == 3 && arg[used] == '\0') {
+        return dims.x > 0 && dims.y > 0 && dims.z > 0;
+    }
+    if (std::sscanf(arg, "%d%n", &dims.x, &used) == 1 && arg[used] == '\0') {
+        dims.y = dims.z = dims.x;
+        return dims.x > 0;
+    }
+    return false;
+}
+
+int main(int argc, const char **argv)
+{
+    OSPError init_error = ospInit(&argc, argv);
+    if (init_error != OSP_NO_ERROR)
+        return init_error;
+
+    BenchConfig config;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "missing value for " << arg << std::endl;
+            return 1;
+        }
+        if (arg == "-field") {
+            config.field = argv[++i];
+        } else if (arg == "-dims") {
+            if (!parse_dims(argv[++i], config.dims)) {
+                std::cerr << "-dims takes N or XxYxZ, not " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (arg == "-voxel-type") {
+            config.voxel_type = argv[++i];
+        } else if (arg == "-image") {
+            config.image = std::atoi(argv[++i]);
+        } else if (arg == "-views") {
+            config.views = std::atoi(argv[++i]);
+        } else if (arg == "-frames") {
+            config.frames = std::atoi(argv[++i]);
+        } else if (arg == "-repeats") {
+            config.repeats = std::atoi(argv[++i]);
+        } else if (arg == "-work-dir") {
+            config.work_dir = argv[++i];
+        } else if (arg == "-o") {
+            config.output = argv[++i];
+        } else {
+            std::cerr << "unknown option " << arg << std::endl;
+            return 1;
+        }
+    }
+    if (config.image < 1 || config.views < 1 || config.frames < 1 || config.repeats < 1) {
+        std::cerr << "-image, -views, -frames and -repeats must be positive" << std::endl;
+        return 1;
+    }
+
+    std::vector<BenchResult> results;
+    {
+        const vec3i dims = config.dims;
+        const vec2i imgSize(config.image, config.image);
+        const double voxels = double(dims.x) * dims.y * dims.z;
+
+        Volume volume;
+        results.push_back(run_scenario(config, "generate", voxels * 1e-6, "Mvoxels/s", nullptr, [&]() {
+            volume = make_synthetic_volume(config.field, dims, config.voxel_type);
+        }));
+        const double gb = volume.n_bytes() * 1e-9;
+
+        const std::string raw_file = config.work_dir + "/bench_volume.raw";
+        write_raw_volume(raw_file, volume);
+        const std::string stats_file = stats_cache_name(raw_file);
+        results.push_back(run_scenario(config, "load", gb, "GB/s", nullptr,
+            [&]() { load_raw_volume(raw_file, dims, config.voxel_type, false, false); }));
+        // the cache for the cached loads
+        load_raw_volume(raw_file, dims, config.voxel_type);
+        results.push_back(run_scenario(config, "load_cached", gb, "GB/s", nullptr,
+            [&]() { load_raw_volume(raw_file, dims, config.voxel_type); }));
+        volatile uint64_t page_sum = 0;
+        results.push_back(run_scenario(config, "load_mmap", gb, "GB/s", nullptr, [&]() {
+            page_sum = touch_pages(load_raw_volume(raw_file, dims, config.voxel_type, true));
+        }));
+        std::remove(raw_file.c_str());
+        std::remove(stats_file.c_str());
+
+        results.push_back(run_scenario(config, "range", gb, "GB/s", nullptr, [&]() {
+            volume.stats = compute_stats(volume);
+        }));
+
+        std::unique_ptr<VolumeScene> scene;
+        results.push_back(run_scenario(config, "scene_build", 1.0, "scenes/s",
+            [&]() { scene.reset(); },
+            [&]() { scene.reset(new VolumeScene(volume, imgSize, "jet", volume.range, false, 8)); }));
+        results.push_back(run_scenario(config, "swap_volume", 1.0, "volumes/s", nullptr,
+            [&]() { scene->setVolume(volume); }));
+
+        // orbit views around the volume, fixed frame count per view
+        const box3f bounds(vec3f(0.f), vec3f(dims));
+        const std::vector<Camera> cameras =
+            gen_orbit_cameras(bounds, config.views, 0, config.views, 0).cameras();
+        auto set_view = [&](const int slot, const size_t view) {
+            scene->cameras[slot].setParam("position", cameras[view].pos);
+            scene->cameras[slot].setParam("direction", cameras[view].dir);
+            scene->cameras[slot].setParam("up", cameras[view].up);
+            scene->cameras[slot].commit();
+        };
+        std::shared_ptr<std::vector<uint32_t>> pixels;
+        auto keep_image = [&](const int slot, const size_t, const int) {
+            uint32_t *fb = (uint32_t *)scene->framebuffers[slot].map(OSP_FB_COLOR);
+            pixels = std::make_shared<std::vector<uint32_t>>(fb, fb + imgSize.x * imgSize.y);
+            scene->framebuffers[slot].unmap(fb);
+        };
+        results.push_back(run_scenario(config, "render", config.views, "views/s", nullptr, [&]() {
+            renderViews(*scene, cameras.size(), config.frames, 0.f, 1, set_view, keep_image);
+        }));
+        scene.reset();
+
+        const int n_images = 64;
+        std::unique_ptr<ImageWriter> writer;
+        for (const ImageFormat format : {ImageFormat::JPG, ImageFormat::PNG}) {
+            const std::string ext = format == ImageFormat::JPG ? "jpg" : "png";
+            results.push_back(run_scenario(config, "encode_" + ext, n_images, "images/s",
+                [&]() { writer.reset(new ImageWriter(std::thread::hardware_concurrency())); },
+                [&]() {
+                    for (int i = 0; i < n_images; ++i) {
+                        writer->write(config.work_dir + "/bench_image" + std::to_string(i) + "." + ext,
+                                      format, imgSize, pixels);
+                    }
+                    writer->finish();
+                }));
+            writer.reset();
+            for (int i = 0; i < n_images; ++i) {
+                std::remove((config.work_dir + "/bench_image" + std::to_string(i) + "." + ext).c_str());
+            }
+        }
+    }
+
+    std::ofstream fout(config.output.c_str());
+    write_json(fout, config, results);
+    if (!fout) {
+        std::cerr << "Failed to write " << config.output << std::endl;
+        return 1;
+    }
+    std::cerr << "results written to " << config.output << std::endl;
+
+    ospShutdown();
+    return 0;
+}
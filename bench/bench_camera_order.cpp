@@ -0,0 +1,97 @@
+// Rendering throughput of orbit cameras in generation order versus the
+// view-coherent order of camera_view_order().
+//
+//   bench_camera_order [n_views] [dims] [image size]
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <numeric>
+#include <vector>
+
+#include "ospray/ospray_cpp.h"
+#include "ospray/ospray_cpp/ext/rkcommon.h"
+
+using namespace rkcommon::math;
+
+#include "load_raw.h"
+#include "synthetic_volume.h"
+#include "volume_scene.h"
+#include "camera_gen.h"
+#include "camera_order.h"
+
+double views_per_second(VolumeScene &scene,
+                        const std::vector<Camera> &cameras,
+                        const std::vector<uint32_t> &order)
+{
+    ospray::cpp::FrameBuffer &framebuffer = scene.framebuffers[0];
+    ospray::cpp::Camera &camera = scene.cameras[0];
+    const auto start = std::chrono::high_resolution_clock::now();
+    for (const uint32_t i : order) {
+        camera.setParam("position", cameras[i].pos);
+        camera.setParam("direction", cameras[i].dir);
+        camera.setParam("up", cameras[i].up);
+        camera.commit();
+        framebuffer.clear();
+        framebuffer.renderFrame(scene.renderer, camera, scene.world).wait();
+    }
+    const auto end = std::chrono::high_resolution_clock::now();
+    return order.size() / std::chrono::duration<double>(end - start).count();
+}
+
+double mean_step(const std::vector<Camera> &cameras, const std::vector<uint32_t> &order)
+{
+    double total = 0.0;
+    for (size_t k = 1; k < order.size(); ++k) {
+        total += length(cameras[order[k]].pos - cameras[order[k - 1]].pos);
+    }
+    return order.size() > 1 ? total / (order.size() - 1) : 0.0;
+}
+
+int main(int argc, const char **argv)
+{
+    OSPError init_error = ospInit(&argc, argv);
+    if (init_error != OSP_NO_ERROR)
+        return init_error;
+
+    const int n_views = argc > 1 ? std::atoi(argv[1]) : 5000;
+    const int n = argc > 2 ? std::atoi(argv[2]) : 128;
+    const int size = argc > 3 ? std::atoi(argv[3]) : 128;
+    const vec2i imgSize(size, size);
+
+    {
+        // radial distance field, so every view sees some structure
+        Volume volume = make_synthetic_volume("sphere", vec3i(n), "float32");
+        VolumeScene scene(volume, imgSize, "jet", volume.range);
+        scene.renderer.setParam("pixelSamples", 1);
+        scene.renderer.commit();
+
+        const box3f bounds(vec3f(0.f), vec3f(n));
+        const std::vector<Camera> cameras =
+            gen_orbit_cameras(bounds, n_views, 0, n_views, 0).cameras();
+
+        std::vector<uint32_t> file_order(cameras.size());
+        std::iota(file_order.begin(), file_order.end(), 0);
+        const auto order_start = std::chrono::high_resolution_clock::now();
+        const std::vector<uint32_t> view_order = camera_view_order(cameras);
+        const auto order_end = std::chrono::high_resolution_clock::now();
+
+        // warm up, so neither order pays for the first frame
+        views_per_second(scene, cameras, std::vector<uint32_t>(1, 0));
+        const double file_vps = views_per_second(scene, cameras, file_order);
+        const double view_vps = views_per_second(scene, cameras, view_order);
+
+        std::cout << "views: " << n_views << ", image " << imgSize.x << "x" << imgSize.y
+                  << ", volume " << n << "^3\n";
+        std::cout << "ordering took "
+                  << std::chrono::duration<double, std::milli>(order_end - order_start).count()
+                  << " ms\n";
+        std::cout << "generation order: " << file_vps << " views/s, mean camera step "
+                  << mean_step(cameras, file_order) << "\n";
+        std::cout << "view order:       " << view_vps << " views/s, mean camera step "
+                  << mean_step(cameras, view_order) << "\n";
+    }
+
+    ospShutdown();
+    return 0;
+}
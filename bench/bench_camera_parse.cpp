@@ -0,0 +1,76 @@
+// Parsing a large camera file with the getline/stringstream loop gen_images
+// used before versus load_cameras_text(). The input is input_5000.txt
+// repeated `scale` times.
+//
+//   bench_camera_parse [input_5000.txt] [scale] [tmp_file]
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include "camera_io.h"
+
+std::vector<Camera> load_cameras_stringstream(const std::string &fname)
+{
+    std::fstream infile(fname);
+    std::string line;
+    std::vector<std::vector<float>> v;
+    while (std::getline(infile, line)) {
+        float value;
+        std::stringstream ss(line);
+        v.push_back(std::vector<float>());
+        while (ss >> value) {
+            v.back().push_back(value);
+        }
+    }
+    std::vector<Camera> cameras;
+    for (size_t i = 0; i < v.size(); i++) {
+        const std::vector<float> temp = v[i];
+        cameras.emplace_back(vec3f{temp[0], temp[1], temp[2]},
+                             vec3f{temp[3], temp[4], temp[5]},
+                             vec3f{temp[6], temp[7], temp[8]});
+    }
+    return cameras;
+}
+
+template <typename F>
+double time_ms(F &&f)
+{
+    const auto start = std::chrono::high_resolution_clock::now();
+    f();
+    const auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+int main(int argc, const char **argv)
+{
+    const std::string input = argc > 1 ? argv[1] : "input_5000.txt";
+    const int scale = argc > 2 ? std::atoi(argv[2]) : 1000;
+    const std::string scaled = argc > 3 ? argv[3] : "bench_cameras.txt";
+
+    {
+        std::ifstream fin(input);
+        std::stringstream contents;
+        contents << fin.rdbuf();
+        if (contents.str().empty()) {
+            std::cerr << "Cannot read " << input << std::endl;
+            return 1;
+        }
+        std::ofstream fout(scaled);
+        for (int i = 0; i < scale; ++i) {
+            fout << contents.str();
+        }
+    }
+
+    size_t n_old = 0, n_new = 0;
+    const double old_ms = time_ms([&]() { n_old = load_cameras_stringstream(scaled).size(); });
+    const double new_ms = time_ms([&]() { n_new = load_cameras_text(scaled).size(); });
+    std::remove(scaled.c_str());
+
+    std::cout << "cameras: " << n_new << " (" << scale << "x " << input << ")\n";
+    std::cout << "getline + stringstream: " << old_ms << " ms\n";
+    std::cout << "load_cameras_text:      " << new_ms << " ms\n";
+    return n_old == n_new ? 0 : 1;
+}
@@ -0,0 +1,105 @@
+// Per-view overhead of creating a new OSPRay camera for every view versus
+// updating the view parameters of one reused camera. After a warm-up the two
+// variants run alternately `repeats` times and the best time of each is
+// reported.
+//
+//   bench_camera_update [n_views] [dims] [repeats]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "ospray/ospray_cpp.h"
+#include "ospray/ospray_cpp/ext/rkcommon.h"
+
+using namespace rkcommon::math;
+
+#include "load_raw.h"
+#include "synthetic_volume.h"
+#include "volume_scene.h"
+
+std::vector<vec3f> orbit(const int n_views, const vec3f &center, const float radius)
+{
+    std::vector<vec3f> positions;
+    for (int i = 0; i < n_views; ++i) {
+        const float phi = 2.f * float(M_PI) * i / n_views;
+        positions.push_back(center + radius * vec3f(std::cos(phi), 0.3f, std::sin(phi)));
+    }
+    return positions;
+}
+
+template <typename F>
+double time_per_view_us(const int n_views, F &&render_view)
+{
+    const auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < n_views; ++i) {
+        render_view(i);
+    }
+    const auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::micro>(end - start).count() / n_views;
+}
+
+int main(int argc, const char **argv)
+{
+    OSPError init_error = ospInit(&argc, argv);
+    if (init_error != OSP_NO_ERROR)
+        return init_error;
+
+    const int n_views = argc > 1 ? std::atoi(argv[1]) : 1000;
+    const int n = argc > 2 ? std::atoi(argv[2]) : 64;
+    const int repeats = std::max(argc > 3 ? std::atoi(argv[3]) : 3, 1);
+    const vec2i imgSize(64, 64);
+
+    {
+        // radial distance field, so every view sees some structure
+        Volume volume = make_synthetic_volume("sphere", vec3i(n), "float32");
+        VolumeScene scene(volume, imgSize, "jet", volume.range);
+        scene.renderer.setParam("pixelSamples", 1);
+        scene.renderer.commit();
+
+        const vec3f center(n / 2.f);
+        const std::vector<vec3f> positions = orbit(n_views, center, 2.f * n);
+        const vec3f up(0.f, 1.f, 0.f);
+
+        auto create_view = [&](const int i) {
+            ospray::cpp::Camera camera("perspective");
+            camera.setParam("aspect", imgSize.x / (float)imgSize.y);
+            camera.setParam("position", positions[i]);
+            camera.setParam("direction", center - positions[i]);
+            camera.setParam("up", up);
+            camera.commit();
+            scene.framebuffers[0].clear();
+            scene.framebuffers[0].renderFrame(scene.renderer, camera, scene.world).wait();
+        };
+        auto reuse_view = [&](const int i) {
+            scene.cameras[0].setParam("position", positions[i]);
+            scene.cameras[0].setParam("direction", center - positions[i]);
+            scene.cameras[0].setParam("up", up);
+            scene.cameras[0].commit();
+            scene.framebuffers[0].clear();
+            scene.framebuffers[0].renderFrame(scene.renderer, scene.cameras[0], scene.world).wait();
+        };
+
+        // warm up, so neither variant pays for the first frame
+        create_view(0);
+        reuse_view(0);
+        double create_us = 0.0;
+        double reuse_us = 0.0;
+        for (int r = 0; r < repeats; ++r) {
+            const double c = time_per_view_us(n_views, create_view);
+            const double u = time_per_view_us(n_views, reuse_view);
+            create_us = r == 0 ? c : std::min(create_us, c);
+            reuse_us = r == 0 ? u : std::min(reuse_us, u);
+        }
+
+        std::cout << "views: " << n_views << ", image " << imgSize.x << "x" << imgSize.y
+                  << ", volume " << n << "^3, best of " << repeats << "\n";
+        std::cout << "new camera per view:  " << create_us << " us/view\n";
+        std::cout << "reused camera:        " << reuse_us << " us/view\n";
+    }
+
+    ospShutdown();
+    return 0;
+}
@@ -0,0 +1,67 @@
+// Range and histogram reduction over a float volume: the two scalar
+// std::min_element / std::max_element passes used before, the fused scalar
+// and SIMD kernels on one core, and the threaded compute_volume_stats().
+//
+//   bench_volume_stats [n_voxels] [repeats]
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "volume_stats.h"
+
+template <typename F>
+double best_ms(const int repeats, F &&f)
+{
+    double best = std::numeric_limits<double>::infinity();
+    for (int r = 0; r < repeats; ++r) {
+        const auto start = std::chrono::high_resolution_clock::now();
+        f();
+        const auto end = std::chrono::high_resolution_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    return best;
+}
+
+int main(int argc, const char **argv)
+{
+    const size_t n = argc > 1 ? std::stoull(argv[1]) : size_t(768) * 336 * 512;
+    const int repeats = argc > 2 ? std::atoi(argv[2]) : 5;
+
+    std::vector<float> voxels(n);
+    std::mt19937 rng(42);
+    std::normal_distribution<float> dist(0.f, 1.f);
+    for (auto &v : voxels) {
+        v = dist(rng);
+    }
+
+    // keeps the results alive so the reductions are not optimized out
+    volatile float sink = 0.f;
+
+    const double minmax_ms = best_ms(repeats, [&]() {
+        sink = *std::min_element(voxels.begin(), voxels.end())
+            + *std::max_element(voxels.begin(), voxels.end());
+    });
+    const double scalar_ms = best_ms(repeats, [&]() {
+        const MinMaxSum r = minmaxsum_scalar(voxels.data(), n, AsFloat());
+        sink = r.min + r.max + float(r.sum);
+    });
+    const double simd_ms = best_ms(repeats, [&]() {
+        const MinMaxSum r = minmaxsum(voxels.data(), n, AsFloat());
+        sink = r.min + r.max + float(r.sum);
+    });
+    const double stats_ms = best_ms(repeats, [&]() {
+        const VolumeStats stats = compute_volume_stats(voxels.data(), n, AsFloat());
+        sink = stats.range.x + float(stats.histogram.size());
+    });
+
+    const double gb = n * sizeof(float) / 1e9;
+    std::cout << "voxels: " << n << " (" << gb << " GB)\n";
+    std::cout << "min_element + max_element:   " << minmax_ms << " ms\n";
+    std::cout << "fused scalar min/max/sum:    " << scalar_ms << " ms\n";
+    std::cout << "fused SIMD min/max/sum:      " << simd_ms << " ms\n";
+    std::cout << "threaded stats + histogram:  " << stats_ms << " ms ("
+              << gb / (stats_ms / 1000.0) << " GB/s)\n";
+    return 0;
+}
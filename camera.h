@@ -0,0 +1,27 @@
+#pragma once
+
+#include "rkcommon/math/vec.h"
+
+using namespace rkcommon::math;
+
+// OSPRay's default fovy of the perspective camera, cameras that don't set
+// their own keep rendering as they did before fovy was passed on
+const float DEFAULT_CAMERA_FOVY = 60.f;
+
+struct Camera {
+    vec3f pos;
+    vec3f dir;
+    vec3f up;
+    float fovy = DEFAULT_CAMERA_FOVY;
+
+    Camera() = default;
+    Camera(const vec3f &pos, const vec3f &dir, const vec3f &up);
+    void setFovy(float f){
+        fovy = f;
+    }
+};
+
+Camera::Camera(const vec3f &pos, const vec3f &dir, const vec3f &up)
+    : pos(pos), dir(dir), up(up)
+{
+}
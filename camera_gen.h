@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "rkcommon/math/box.h"
+#include "rkcommon/math/vec.h"
+#include "rkcommon/tasking/parallel_for.h"
+#include "camera.h"
+
+using namespace rkcommon::math;
+
+// cameras per Fibonacci sphere, every orbit shell gets its own radius
+const size_t ORBIT_SHELL_POINTS = 500;
+// cameras generated per task
+const size_t CAMERA_GEN_BLOCK = 4096;
+
+inline uint64_t splitmix64(uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+// Uniform float in [0, 1) for draw `counter` of the stream `seed`. Draws
+// are a pure function of (seed, counter), so any of them can be reproduced
+// without generating the ones before it.
+inline float counter_uniform(const uint64_t seed, const uint64_t counter)
+{
+    return (splitmix64(splitmix64(seed) ^ counter) >> 40) * (1.f / 16777216.f);
+}
+
+// Cameras in structure-of-arrays layout
+struct CameraBatch {
+    std::vector<float> pos_x, pos_y, pos_z;
+    std::vector<float> dir_x, dir_y, dir_z;
+    std::vector<float> up_x, up_y, up_z;
+
+    void resize(const size_t n)
+    {
+        for (auto *v : {&pos_x, &pos_y, &pos_z, &dir_x, &dir_y, &dir_z, &up_x, &up_y, &up_z}) {
+            v->resize(n);
+        }
+    }
+
+    size_t size() const
+    {
+        return pos_x.size();
+    }
+
+    Camera camera(const size_t i) const
+    {
+        return Camera(vec3f(pos_x[i], pos_y[i], pos_z[i]),
+                      vec3f(dir_x[i], dir_y[i], dir_z[i]),
+                      vec3f(up_x[i], up_y[i], up_z[i]));
+    }
+
+    std::vector<Camera> cameras() const
+    {
+        std::vector<Camera> cams(size());
+        rkcommon::tasking::parallel_for((size() + CAMERA_GEN_BLOCK - 1) / CAMERA_GEN_BLOCK,
+                                        [&](const size_t b) {
+            const size_t end = std::min((b + 1) * CAMERA_GEN_BLOCK, size());
+            for (size_t i = b * CAMERA_GEN_BLOCK; i < end; ++i) {
+                cams[i] = camera(i);
+            }
+        });
+        return cams;
+    }
+};
+
+// Cameras [begin, begin + count) of a set of `total` cameras looking at the
+// center of world_bounds from shells of ORBIT_SHELL_POINTS points on a
+// Fibonacci sphere (the last shell takes the remainder). Each shell's radius
+// is drawn from [0, 2) times the diagonal of world_bounds using `seed`, so a
+// camera only depends on (seed, total, index) and any range of the set can be
+// regenerated on its own.
+CameraBatch gen_orbit_cameras(const box3f &world_bounds,
+                              const size_t total,
+                              const size_t begin,
+                              const size_t count,
+                              const uint64_t seed)
+{
+    CameraBatch batch;
+    batch.resize(count);
+    const vec3f center = world_bounds.center();
+    const float diagonal = length(world_bounds.size());
+    const float increment = M_PI * (3.f - std::sqrt(5.f));
+
+    rkcommon::tasking::parallel_for((count + CAMERA_GEN_BLOCK - 1) / CAMERA_GEN_BLOCK,
+                                    [&](const size_t b) {
+        const size_t first = b * CAMERA_GEN_BLOCK;
+        const size_t n = std::min(CAMERA_GEN_BLOCK, count - first);
+        float *px = &batch.pos_x[first], *py = &batch.pos_y[first], *pz = &batch.pos_z[first];
+        float *dx = &batch.dir_x[first], *dy = &batch.dir_y[first], *dz = &batch.dir_z[first];
+        float *ux = &batch.up_x[first], *uy = &batch.up_y[first], *uz = &batch.up_z[first];
+        // every camera is closed-form in its index, blocks need no shared state
+        for (size_t k = 0; k < n; ++k) {
+            const size_t i = begin + first + k;
+            const size_t shell = i / ORBIT_SHELL_POINTS;
+            const size_t j = i - shell * ORBIT_SHELL_POINTS;
+            const size_t shell_points = std::min(ORBIT_SHELL_POINTS, total - shell * ORBIT_SHELL_POINTS);
+            const float radius = diagonal * 2.f * counter_uniform(seed, shell);
+
+            const float offset = 2.f / shell_points;
+            const float y = ((j * offset) - 1.f) + offset / 2.f;
+            const float r = std::sqrt(std::max(1.f - y * y, 0.f));
+            const float phi = j * increment;
+            const float x = r * std::cos(phi);
+            const float z = r * std::sin(phi);
+
+            px[k] = center.x + x * radius;
+            py[k] = center.y + y * radius;
+            pz[k] = center.z + z * radius;
+            dx[k] = -x;
+            dy[k] = -y;
+            dz[k] = -z;
+            ux[k] = 0.f;
+            uy[k] = -1.f;
+            uz[k] = 0.f;
+        }
+    });
+    return batch;
+}
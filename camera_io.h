@@ -0,0 +1,262 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "camera.h"
+#include "mapped_file.h"
+
+// Camera files come in two formats.
+//
+// Text files list one camera per line as whitespace separated
+//   pos.x pos.y pos.z dir.x dir.y dir.z up.x up.y up.z [fovy]
+// where a missing fovy is DEFAULT_CAMERA_FOVY.
+//
+// Binary files (.bin) start with a CameraFileHeader followed by `count`
+// packed records of pos, dir, up and fovy as 10 floats, which is the layout
+// of Camera. The records start 4-byte aligned right after the header, so a
+// mapped file can be used directly as an array of Camera.
+struct CameraFileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t count;
+};
+
+const char CAMERA_FILE_MAGIC[8] = {'O', 'S', 'P', 'C', 'A', 'M', 'S', '\0'};
+// version 1 files baked a default fovy of 45 into cameras without one
+const uint32_t CAMERA_FILE_VERSION = 2;
+
+static_assert(sizeof(Camera) == 10 * sizeof(float), "Camera must be packed floats");
+static_assert(sizeof(CameraFileHeader) % alignof(Camera) == 0, "records must stay aligned");
+
+inline bool is_blank(const char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+// Parses one number starting at p. Plain decimal numbers, which is all the
+// camera writers produce, are converted directly; anything else (inf, nan,
+// very long mantissas) falls back to strtof on a copy of the token.
+// Returns the position after the number, or nullptr if p is not a number.
+inline const char *parse_float(const char *p, const char *end, float &value)
+{
+    static const double pow10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                   1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                   1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    const char *start = p;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        ++p;
+    }
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; ++p, ++digits) {
+        mantissa = mantissa * 10 + uint64_t(*p - '0');
+    }
+    if (p < end && *p == '.') {
+        for (++p; p < end && *p >= '0' && *p <= '9'; ++p, ++digits) {
+            mantissa = mantissa * 10 + uint64_t(*p - '0');
+            --exponent;
+        }
+    }
+    if (digits > 0 && p < end && (*p == 'e' || *p == 'E')) {
+        const char *q = p + 1;
+        bool exp_negative = false;
+        if (q < end && (*q == '-' || *q == '+')) {
+            exp_negative = *q == '-';
+            ++q;
+        }
+        if (q < end && *q >= '0' && *q <= '9') {
+            int e = 0;
+            for (; q < end && *q >= '0' && *q <= '9'; ++q) {
+                e = std::min(e * 10 + (*q - '0'), 10000);
+            }
+            exponent += exp_negative ? -e : e;
+            p = q;
+        }
+    }
+
+    const bool simple = digits > 0 && digits <= 19 && exponent >= -22 && exponent <= 22
+        && (p == end || is_blank(*p) || *p == '\n');
+    if (simple) {
+        const double v = exponent < 0 ? double(mantissa) / pow10[-exponent]
+                                      : double(mantissa) * pow10[exponent];
+        value = float(negative ? -v : v);
+        return p;
+    }
+
+    // slow path
+    char token[64];
+    size_t len = 0;
+    for (p = start; p < end && !is_blank(*p) && *p != '\n' && len + 1 < sizeof(token); ++p) {
+        token[len++] = *p;
+    }
+    token[len] = '\0';
+    char *token_end = nullptr;
+    value = std::strtof(token, &token_end);
+    if (len == 0 || token_end != token + len) {
+        return nullptr;
+    }
+    return p;
+}
+
+// Reads a camera text file through a memory mapping straight into a flat
+// vector, without per-line string or stream objects.
+std::vector<Camera> load_cameras_text(const std::string &fname)
+{
+    MappedFile file(fname);
+    const char *p = static_cast<const char *>(file.addr);
+    const char *end = p + file.size;
+
+    std::vector<Camera> cameras;
+    // lines are about 80 bytes, reserving avoids most of the regrowth
+    cameras.reserve(file.size / 64);
+
+    size_t line = 1;
+    while (p < end) {
+        float v[10];
+        int n = 0;
+        while (p < end && *p != '\n') {
+            if (is_blank(*p)) {
+                ++p;
+                continue;
+            }
+            float value = 0.f;
+            const char *next = n < 10 ? parse_float(p, end, value) : nullptr;
+            if (!next) {
+                throw std::runtime_error("Bad camera in " + fname + " line " + std::to_string(line));
+            }
+            v[n++] = value;
+            p = next;
+        }
+        if (n != 0 && n != 9 && n != 10) {
+            throw std::runtime_error("Bad camera in " + fname + " line " + std::to_string(line));
+        }
+        if (n > 0) {
+            cameras.emplace_back(vec3f(v[0], v[1], v[2]), vec3f(v[3], v[4], v[5]), vec3f(v[6], v[7], v[8]));
+            if (n == 10) {
+                cameras.back().setFovy(v[9]);
+            }
+        }
+        // step over the newline, the last line may not have one
+        if (p < end) {
+            ++p;
+        }
+        ++line;
+    }
+    return cameras;
+}
+
+void print_cameras(const std::vector<Camera> &cameras)
+{
+    for (size_t i = 0; i < cameras.size(); i++) {
+        std::cout << "index: " << i << "\n";
+        std::cout << "pos: " << cameras[i].pos << "\n";
+        std::cout << "dir: " << cameras[i].dir << "\n";
+        std::cout << "up: " << cameras[i].up << "\n";
+    }
+}
+
+bool is_binary_camera_file(const std::string &fname)
+{
+    char magic[sizeof(CAMERA_FILE_MAGIC)] = {0};
+    FILE *fin = std::fopen(fname.c_str(), "rb");
+    if (!fin) {
+        return false;
+    }
+    const bool binary = std::fread(magic, sizeof(magic), 1, fin) == 1
+        && std::memcmp(magic, CAMERA_FILE_MAGIC, sizeof(magic)) == 0;
+    std::fclose(fin);
+    return binary;
+}
+
+// Reads all records of a binary camera file with a single read
+std::vector<Camera> load_cameras_binary(const std::string &fname)
+{
+    FILE *fin = std::fopen(fname.c_str(), "rb");
+    if (!fin) {
+        throw std::runtime_error("Failed to open " + fname);
+    }
+    CameraFileHeader header;
+    if (std::fread(&header, sizeof(header), 1, fin) != 1
+        || std::memcmp(header.magic, CAMERA_FILE_MAGIC, sizeof(header.magic)) != 0
+        || header.version != CAMERA_FILE_VERSION || header.record_size != sizeof(Camera)) {
+        std::fclose(fin);
+        throw std::runtime_error("Unsupported camera file " + fname);
+    }
+    std::vector<Camera> cameras(header.count);
+    const size_t n = std::fread(cameras.data(), sizeof(Camera), cameras.size(), fin);
+    std::fclose(fin);
+    if (n != cameras.size()) {
+        throw std::runtime_error("Truncated camera file " + fname);
+    }
+    return cameras;
+}
+
+// Either format, detected from the file contents
+std::vector<Camera> load_cameras(const std::string &fname)
+{
+    if (is_binary_camera_file(fname)) {
+        return load_cameras_binary(fname);
+    }
+    return load_cameras_text(fname);
+}
+
+void save_cameras_binary(const std::string &fname, const std::vector<Camera> &cameras)
+{
+    CameraFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, CAMERA_FILE_MAGIC, sizeof(header.magic));
+    header.version = CAMERA_FILE_VERSION;
+    header.record_size = sizeof(Camera);
+    header.count = cameras.size();
+
+    FILE *fout = std::fopen(fname.c_str(), "wb");
+    if (!fout) {
+        throw std::runtime_error("Failed to create " + fname);
+    }
+    const bool ok = std::fwrite(&header, sizeof(header), 1, fout) == 1
+        && std::fwrite(cameras.data(), sizeof(Camera), cameras.size(), fout) == cameras.size();
+    if (std::fclose(fout) != 0 || !ok) {
+        throw std::runtime_error("Failed to write " + fname);
+    }
+}
+
+// %.9g round-trips every float exactly
+void save_cameras_text(const std::string &fname, const std::vector<Camera> &cameras)
+{
+    FILE *fout = std::fopen(fname.c_str(), "w");
+    if (!fout) {
+        throw std::runtime_error("Failed to create " + fname);
+    }
+    for (const auto &c : cameras) {
+        std::fprintf(fout, "%.9g %.9g %.9g %.9g %.9g %.9g %.9g %.9g %.9g %.9g\n",
+                     c.pos.x, c.pos.y, c.pos.z, c.dir.x, c.dir.y, c.dir.z,
+                     c.up.x, c.up.y, c.up.z, c.fovy);
+    }
+    if (std::fclose(fout) != 0) {
+        throw std::runtime_error("Failed to write " + fname);
+    }
+}
+
+// Binary for .bin files, text otherwise
+void save_cameras(const std::string &fname, const std::vector<Camera> &cameras)
+{
+    const std::string ext = ".bin";
+    if (fname.size() >= ext.size() && fname.compare(fname.size() - ext.size(), ext.size(), ext) == 0) {
+        save_cameras_binary(fname, cameras);
+    } else {
+        save_cameras_text(fname, cameras);
+    }
+}
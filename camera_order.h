@@ -0,0 +1,97 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+#include "rkcommon/math/vec.h"
+#include "camera.h"
+
+using namespace rkcommon::math;
+
+// bits per axis of the Hilbert curve over view directions
+const int CAMERA_ORDER_BITS = 16;
+// cameras are grouped into this many distance bands before ordering by
+// direction, coarse so that a continuous spread of distances still keeps
+// neighbouring directions together
+const int CAMERA_ORDER_BANDS = 64;
+
+// Octahedral map of a unit vector onto [0, 1]^2, neighbouring directions
+// stay neighbours in the square
+inline vec2f octahedral_encode(const vec3f &d)
+{
+    const float l1 = std::abs(d.x) + std::abs(d.y) + std::abs(d.z);
+    vec3f p = l1 > 0.f ? d / l1 : vec3f(0.f, 0.f, 1.f);
+    vec2f e(p.x, p.y);
+    if (p.z < 0.f) {
+        e.x = (1.f - std::abs(p.y)) * (p.x >= 0.f ? 1.f : -1.f);
+        e.y = (1.f - std::abs(p.x)) * (p.y >= 0.f ? 1.f : -1.f);
+    }
+    return vec2f(e.x * 0.5f + 0.5f, e.y * 0.5f + 0.5f);
+}
+
+// Distance of (x, y) along the Hilbert curve filling a 2^bits square
+inline uint64_t hilbert_index(uint32_t x, uint32_t y, const int bits)
+{
+    uint64_t d = 0;
+    for (uint32_t s = 1u << (bits - 1); s > 0; s >>= 1) {
+        const uint32_t rx = (x & s) > 0;
+        const uint32_t ry = (y & s) > 0;
+        d += uint64_t(s) * s * ((3 * rx) ^ ry);
+        // rotate the quadrant
+        if (ry == 0) {
+            if (rx == 1) {
+                x = s - 1 - x;
+                y = s - 1 - y;
+            }
+            std::swap(x, y);
+        }
+    }
+    return d;
+}
+
+// Camera indices in a view-coherent render order: bands of distance from the
+// centroid of the cameras, each walked along a Hilbert curve over the
+// octahedral map of the view direction. Alternate bands walk the curve
+// backwards, so consecutive views are also close across band boundaries.
+// order[k] is the original index of the k-th camera to render.
+std::vector<uint32_t> camera_view_order(const std::vector<Camera> &cameras)
+{
+    std::vector<uint32_t> order(cameras.size());
+    std::iota(order.begin(), order.end(), 0);
+    if (cameras.empty()) {
+        return order;
+    }
+
+    vec3f centroid(0.f);
+    for (const auto &c : cameras) {
+        centroid = centroid + c.pos;
+    }
+    centroid = centroid / float(cameras.size());
+    float max_dist = 0.f;
+    for (const auto &c : cameras) {
+        max_dist = std::max(max_dist, length(c.pos - centroid));
+    }
+
+    const uint32_t grid = (1u << CAMERA_ORDER_BITS) - 1;
+    const uint64_t curve_end = (uint64_t(1) << (2 * CAMERA_ORDER_BITS)) - 1;
+    std::vector<uint64_t> keys(cameras.size());
+    for (size_t i = 0; i < cameras.size(); ++i) {
+        const Camera &c = cameras[i];
+        const float t = max_dist > 0.f ? length(c.pos - centroid) / max_dist : 0.f;
+        const uint64_t band = std::min(int(t * CAMERA_ORDER_BANDS), CAMERA_ORDER_BANDS - 1);
+        // the cameras look inwards, order by where they are looking from
+        const vec2f e = octahedral_encode(-c.dir);
+        uint64_t h = hilbert_index(uint32_t(e.x * grid), uint32_t(e.y * grid), CAMERA_ORDER_BITS);
+        if (band & 1) {
+            h = curve_end - h;
+        }
+        keys[i] = (band << (2 * CAMERA_ORDER_BITS)) | h;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](const uint32_t a, const uint32_t b) {
+        return keys[a] < keys[b];
+    });
+    return order;
+}
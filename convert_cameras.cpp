@@ -0,0 +1,21 @@
+#include <iostream>
+
+#include "camera_io.h"
+
+// Converts camera files between the text and the binary format, the output
+// format follows the extension (.bin for binary)
+//
+//   convert_cameras input.txt cameras.bin
+//   convert_cameras cameras.bin input.txt
+
+int main(int argc, const char **argv)
+{
+    if (argc != 3) {
+        std::cerr << "usage: " << argv[0] << " <input> <output>" << std::endl;
+        return 1;
+    }
+    const std::vector<Camera> cameras = load_cameras(argv[1]);
+    save_cameras(argv[2], cameras);
+    std::cout << cameras.size() << " cameras written to " << argv[2] << std::endl;
+    return 0;
+}
@@ -21,6 +21,7 @@ using namespace rkcommon::math;
 #include "make_ospvolume.h"
 #include "make_tf.h"
 #include "load_camera.h"
+#include "camera_io.h"
 
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb_image_write.h"
@@ -44,7 +45,7 @@ int main(int argc, const char **argv)
     //load single volume 
     Volume volume;
     const vec3i dims{args.dims, args.dims, args.dims};
-    volume = load_raw_volume(args.filename, dims, voxel_type);
+    volume = load_raw_volume(args.filename, dims, voxel_type, false, true, args.verbose);
 
     // Imgae size 
     vec2i imgSize;
@@ -54,24 +55,11 @@ int main(int argc, const char **argv)
     //create a list of camera positions 
     const int num = args.n_samples;
     const box3f worldBound = box3f(-dims / 2 * volume.spacing, dims / 2 * volume.spacing);
-    std::vector<Camera> cameras = gen_cameras(num, worldBound);
+    std::vector<Camera> cameras = gen_cameras(num, worldBound, args.seed);
     std::cout << "camera pos:" << cameras.size() << std::endl;
     
-    std::ofstream outfile;
-    // save camera to file
-    outfile.open("/home/mengjiao/Desktop/projects/osp-gen-images/input.txt");
-    for(int i = 0; i < cameras.size(); i++){
-        outfile << cameras[i].pos.x << " " <<
-                   cameras[i].pos.y << " " <<
-                   cameras[i].pos.z << " " <<
-                   cameras[i].dir.x << " " <<
-                   cameras[i].dir.y << " " <<
-                   cameras[i].dir.z << " " << 
-                   cameras[i].up.x  << " " << 
-                   cameras[i].up.y  << " " << 
-                   cameras[i].up.z  << "\n";
-    }
-    outfile.close();
+    // save cameras to file, binary if it ends in .bin
+    save_cameras(args.camera_file, cameras);
     
     // debug 
     // for(int i = 0; i < cameras.size(); i++){
@@ -122,11 +110,12 @@ int main(int argc, const char **argv)
         ospray::cpp::FrameBuffer framebuffer(imgSize.x, imgSize.y, OSP_FB_SRGBA, OSP_FB_COLOR | OSP_FB_ACCUM);
         framebuffer.clear();
 
+        // create and setup camera, only the view changes per image
+        ospray::cpp::Camera camera("perspective");
+        camera.setParam("aspect", imgSize.x / (float)imgSize.y);
+
         for(int i = 0; i < cameras.size(); i++){
             framebuffer.clear();
-            //create and setup camera
-            ospray::cpp::Camera camera("perspective");
-            camera.setParam("aspect", imgSize.x / (float)imgSize.y);
             camera.setParam("position", cameras[i].pos);
             camera.setParam("direction", cameras[i].dir);
             camera.setParam("up", cameras[i].up);
@@ -9,6 +9,7 @@
 #include <alloca.h>
 #endif
 
+#include <atomic>
 #include <vector>
 #include <fstream>
 
@@ -24,6 +25,10 @@ using namespace rkcommon::math;
 #include "load_camera.h"
 #include "ArcballCamera.h"
 #include "ParamReader.h"
+#include "accumulate.h"
+#include "image_writer.h"
+#include "progress_journal.h"
+#include "trace.h"
 
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb_image_write.h"
@@ -40,11 +45,14 @@ int main(int argc, const char **argv)
     // parse Args
     Args args;
     parseArgs(argc, argv, args);
+    if(!args.trace.empty()){
+        Tracer::instance().enableTrace(args.trace);
+    }
     // std::cout << "debug" << std::endl;
     // load volume
     // const vec3i dims{args.dims, args.dims*2, args.dims};
     const vec3i dims{768, 336, 512};
-    Volume volume = load_raw_volume(args.filename, dims, voxel_type);
+    Volume volume = load_raw_volume(args.filename, dims, voxel_type, args.use_mmap, true, args.verbose);
     volume.dims = dims;
 
     // std::cout << "debug 0" << std::endl;
@@ -102,40 +110,76 @@ int main(int argc, const char **argv)
         renderer.commit();
 
         // create and setup framebuffer
-        ospray::cpp::FrameBuffer framebuffer(imgSize.x, imgSize.y, OSP_FB_SRGBA, OSP_FB_COLOR | OSP_FB_ACCUM);
+        const int channels = OSP_FB_COLOR | OSP_FB_ACCUM
+            | (args.variance_threshold > 0.f ? OSP_FB_VARIANCE : 0);
+        ospray::cpp::FrameBuffer framebuffer(imgSize.x, imgSize.y, OSP_FB_SRGBA, channels);
         framebuffer.clear();
 
+        // views are journaled once both images are written, with -resume the
+        // views of the journal are skipped
+        std::string journal_file = args.journal;
+        if(journal_file.empty())
+            journal_file = out_dir.empty() ? "progress.journal" : out_dir + "/progress.journal";
+        ProgressJournal journal(journal_file, args.resume, out_dir.empty() ? "." : out_dir);
+        if(args.resume){
+            std::cout << "resuming, " << journal.resumed() << " views already done" << std::endl;
+        }
+
+        // PNG and JPG compression runs on its own threads
+        ImageWriter writer(args.encode_threads, args.encode_queue);
+
+        // create and setup camera, only the view changes per image
+        ospray::cpp::Camera camera("perspective");
+        camera.setParam("aspect", imgSize.x / (float)imgSize.y);
+
         for(int i = 0; i < params.size(); i++){
+            std::string filename = out_dir + "/png/" + "volume_cam" + std::to_string(i)  + ".png";
+            std::string jpg_filename = out_dir + "/jpg/" + "volume_cam_" + std::to_string(i)  + ".jpg";
+            if(journal.done(args.timeStep, i))
+                continue;
             std::cout << "index " << i << std::endl;
             framebuffer.clear();
             //create and setup camera
             // std::cout << "debug0" << std::endl;
             Camera c = gen_cameras_from_vtk(params[i], volume);
             // std::cout << "debug1" << std::endl;
-            ospray::cpp::Camera camera("perspective");
-            camera.setParam("aspect", imgSize.x / (float)imgSize.y);
             camera.setParam("position", c.pos);
             camera.setParam("direction", c.dir);
             camera.setParam("up", c.up);
             camera.setParam("fovy", c.fovy);
             camera.commit(); // commit each object to indicate modifications are done
-            // render 10 more frames, which are accumulated to result in a better
-            // converged image
-            for (int frames = 0; frames < 100; frames++)
-                framebuffer.renderFrame(renderer, camera, world);
-
-            uint32_t *fb = (uint32_t *)framebuffer.map(OSP_FB_COLOR);
+            // accumulate frames until the image converged (with
+            // -variance-threshold) or -max-frames are rendered
+            const int frames = accumulateFrames(framebuffer, renderer, camera, world,
+                                                args.max_frames, args.variance_threshold);
+            std::cout << "frames " << frames << std::endl;
+
+            std::shared_ptr<std::vector<uint32_t>> pixels;
+            {
+                TraceScope scope("map_copy");
+                uint32_t *fb = (uint32_t *)framebuffer.map(OSP_FB_COLOR);
+                pixels = std::make_shared<std::vector<uint32_t>>(fb, fb + imgSize.x * imgSize.y);
+                framebuffer.unmap(fb);
+            }
+            Tracer::instance().countImage();
             // std::cout << "file dir " << f.fileDir << std::endl;
-            std::string filename = out_dir + "/png/" + "volume_cam" + std::to_string(i)  + ".png";
-            std::string jpg_filename = out_dir + "/jpg/" + "volume_cam_" + std::to_string(i)  + ".jpg";
             // + "_" + std::to_string(index)
             // std::cout << filename << std::endl;
-            stbi_write_png(filename.c_str(), imgSize.x, imgSize.y, 4, fb, imgSize.x * 4);
-            stbi_write_jpg(jpg_filename.c_str(), imgSize.x, imgSize.y, 4, fb, 100);
-            framebuffer.unmap(fb);
+            auto remaining = std::make_shared<std::atomic<int>>(2);
+            auto written = [&journal, &args, remaining, i](){
+                if(--*remaining == 0)
+                    journal.record(args.timeStep, i);
+            };
+            writer.write(filename, ImageFormat::PNG, imgSize, pixels, written);
+            writer.write(jpg_filename, ImageFormat::JPG, imgSize, pixels, written);
 
         }
+        writer.finish();
+        journal.sync();
+        writer.printStats(std::cout);
     }
+    Tracer::instance().printSummary(std::cout);
+    Tracer::instance().finishTrace();
 
     
     
@@ -11,6 +11,7 @@
 
 #include <vector>
 #include <fstream>
+#include <numeric>
 
 #include "ospray/ospray_cpp.h"
 #include "ospray/ospray_cpp/ext/rkcommon.h"
@@ -21,8 +22,18 @@ using namespace rkcommon::math;
 #include "parseArgs.h"
 #include "make_ospvolume.h"
 #include "make_tf.h"
+#include "volume_scene.h"
+#include "view_scheduler.h"
+#include "image_writer.h"
+#include "shard_writer.h"
 #include "load_camera.h"
+#include "camera_io.h"
+#include "camera_order.h"
 #include "ArcballCamera.h"
+#include "prefetch.h"
+#include "series_stats.h"
+#include "progress_journal.h"
+#include "trace.h"
 
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb_image_write.h"
@@ -30,14 +41,6 @@ using namespace rkcommon::math;
 const std::string voxel_type = "float32";
 // const vec2f range{-1.0f, 1.0f};
 
-template<typename T>
-std::vector<T> s(std::vector<T> const &v, int m, int n) {
-   auto first = v.begin() + m;
-   auto last = v.begin() + n + 1;
-   std::vector<T> vector(first, last);
-   return vector;
-}
-
 int main(int argc, const char **argv)
 {
     //initialize ospray
@@ -48,155 +51,215 @@ int main(int argc, const char **argv)
     // parse Args
     Args args;
     parseArgs(argc, argv, args);
+    // phase timings are summarized at the end, -trace also writes every
+    // event to a Chrome trace file
+    if(!args.trace.empty()){
+        Tracer::instance().enableTrace(args.trace);
+    }
     
     // load cameras info 
-    std::fstream infile("input.txt");
-    if(!infile.is_open()) 
-        std::cout << "Cannot read file" << "\n";
-
-    std::string line;
-    std::vector<std::vector<float>> v;
-    int i = 0;
-
-    while (std::getline(infile, line)){
-        float value;
-        std::stringstream ss(line);
-        v.push_back(std::vector<float>());
-        while (ss >> value){
-            v[i].push_back(value);
-        }
-        ++i;
-    }
-    // std::cout << "v size " << v.size() << std::endl;
-    std::vector<Camera> cameras;
-    for (int i = 0; i < v.size(); i++){
-        std::vector<float> temp = v[i];
-        vec3f pos{temp[0], temp[1], temp[2]};
-        vec3f dir{temp[3], temp[4], temp[5]};
-        vec3f up{temp[6], temp[7], temp[8]};
-        cameras.emplace_back(pos, dir, up);
-    }
+    std::vector<Camera> cameras = load_cameras(args.camera_file);
+    std::cout << cameras.size() << " cameras" << std::endl;
     // debug
-    for(int i = 0; i < cameras.size(); i++){
-        std::cout << "index: " << i << "\n";
-        std::cout << "pos: " << cameras[i].pos << "\n";
-        std::cout << "dir: " << cameras[i].dir << "\n";
-        std::cout << "up: " << cameras[i].up << "\n";
+    if(args.verbose){
+        print_cameras(cameras);
+    }
+    // with -camera-order the views are rendered along a space-filling curve
+    // over the view directions, images keep the original camera index
+    std::vector<uint32_t> camera_order(cameras.size());
+    std::iota(camera_order.begin(), camera_order.end(), 0);
+    if(args.camera_order){
+        camera_order = camera_view_order(cameras);
     }
     // load all volume files 
-    std::vector<timesteps> files;
-    for(const auto &dir : args.timeStepPaths){
-        DIR *dp = opendir(dir.c_str());
-        if (!dp) {
-            throw std::runtime_error("failed to open directory: " + dir);
-        }
-        for(dirent *e = readdir(dp); e; e = readdir(dp)){
-            std::string name = e ->d_name;
-            // std::cout << "name " << name << std::endl;
-            if(name.length() > 3){
-                // std::cout << name.substr(10, name.find(".") - 10) << std::endl;
-                const int timestep = std::stoi(name.substr(10, name.find(".") - 10));
-                const std::string filename = dir + "/" + name;
-                std::cout << filename << " " << timestep << std::endl;
-                timesteps t(timestep, filename);
-                files.push_back(t);
-            }
-        }
+    const Tracer::clock::time_point scan_start = Tracer::clock::now();
+    const std::vector<timesteps> files = scan_timestep_files(args.timeStepPaths);
+    for(const auto &t : files){
+        std::cout << t.fileDir << " " << t.timeStep << std::endl;
     }
-    // Sort time steps 
-    std::sort(files.begin(), files.end(), sort_timestep());
+    Tracer::instance().record("scan", scan_start, Tracer::clock::now());
 
     // Imgae size 
     vec2i imgSize;
     imgSize.x = 256; // width
     imgSize.y = 256; // height
 
-    int index = 1;
+    // the transfer function spans the range of the whole series, taken from
+    // -range or the per-file stats caches (filled on first use), optionally
+    // clipped to -range-percentile
+    const vec3i dims{args.dims, args.dims, args.dims};
+    vec2f range = args.range;
+    if(!args.has_range){
+        TraceScope scope("range");
+        range = series_range(load_series_stats(files, dims, voxel_type, args.use_mmap, args.threads,
+                                            size_t(args.stats_mem) << 20), args);
+    }
+    std::cout << "transfer function range: " << range << std::endl;
+
+    // with -shard i/N only a contiguous slice of the (timestep, camera) jobs
+    // is rendered by this process, the range above still covers the series
+    const uint64_t n_cameras = cameras.size();
+    const JobRange jobs = job_range(files.size() * n_cameras, args.shard);
+    // the cameras of timestep t that fall in the shard's jobs
+    auto camera_range = [&](const size_t t){
+        const uint64_t first_job = t * n_cameras;
+        const uint64_t begin = std::max(jobs.begin, first_job);
+        const uint64_t end = std::max(std::min(jobs.end, first_job + n_cameras), begin);
+        return std::make_pair(size_t(begin - first_job), size_t(end - first_job));
+    };
+
+    // completed jobs are journaled once their image is written, with -resume
+    // the jobs of the journal are skipped and timesteps without any job left
+    // are not even loaded. Images go to the working directory, which the
+    // journal syncs once per batch before recording it.
+    if(args.resume && !args.dataset.empty()){
+        std::cerr << "-resume is only supported for image output, not -dataset" << std::endl;
+        return 1;
+    }
+    std::unique_ptr<ProgressJournal> journal;
+    if(args.dataset.empty()){
+        const std::string journal_file = args.journal.empty() ? "progress.journal" : args.journal;
+        journal.reset(new ProgressJournal(shard_prefix(journal_file, args.shard), args.resume, "."));
+        if(args.resume){
+            std::cout << "resuming, " << journal->resumed() << " jobs already done" << std::endl;
+        }
+    }
+    auto image_name = [](const int timestep, const int camera){
+        return "volume_ts" + std::to_string(timestep) + "_cam" + std::to_string(camera) + ".jpg";
+    };
+    auto job_done = [&](const int timestep, const int camera){
+        return journal && journal->done(timestep, camera);
+    };
+
+    std::vector<timesteps> shard_files;
+    std::vector<size_t> shard_file_index;
+    for(size_t t = 0; t < files.size(); t++){
+        const auto cams = camera_range(t);
+        for(size_t k = cams.first; k < cams.second; k++){
+            if(!job_done(files[t].timeStep, camera_order[k])){
+                shard_files.push_back(files[t]);
+                shard_file_index.push_back(t);
+                break;
+            }
+        }
+    }
+    if(args.shard.count > 1){
+        std::cout << "shard " << args.shard.index << "/" << args.shard.count << ": jobs "
+                  << jobs.begin << " to " << jobs.end << " of " << files.size() * n_cameras << std::endl;
+    }
+
+    // timestep N+1.. are loaded in the background while N renders,
+    // -prefetch-mem is the budget for queued volumes in MB
+    TimestepPrefetcher prefetcher(shard_files, dims, voxel_type, args.use_mmap,
+                                  args.prefetch, size_t(args.prefetch_mem) << 20);
+    timesteps f(0, "");
+    Volume volume;
+    // built for the first timestep and reused for the rest of the series
+    std::unique_ptr<VolumeScene> scene;
+    size_t total_frames = 0;
+    size_t total_images = 0;
+
+    // views in flight at once, and the threads compressing finished images
+    const int n_framebuffers = std::max(args.fb_ring, 1);
+    // accumulated frames of a single view rendered by one renderFrame call,
+    // a view takes -max-frames / -frames-per-view-launch launches and with
+    // -variance-threshold converges at a multiple of it
+    const int frames_per_launch = std::max(std::min(args.frames_per_view_launch, args.max_frames), 1);
+    ImageWriter writer(args.encode_threads, args.encode_queue);
+    size_t file_index = 0;
+    // with -dataset the frames are appended to shard files instead of JPGs
+    std::unique_ptr<ShardWriter> dataset;
+    if(!args.dataset.empty()){
+        dataset.reset(new ShardWriter(shard_prefix(args.dataset, args.shard), imgSize, args.dataset_rgb ? 3 : 4,
+                                      size_t(args.dataset_shard_mb) << 20));
+    }
 
     // for each file render images with varying camera position 
-    for(auto f : files){
+    while(prefetcher.next(f, volume)){
         // timesteps f = files[0];
         std::cout << "volume file : " << f.fileDir << std::endl;
-        Volume volume;
-        const vec3i dims{args.dims, args.dims, args.dims};
-        volume = load_raw_volume(f.fileDir, dims, voxel_type);
         // box3f worldBound = box3f(-dims / 2 * volume.spacing, dims / 2 * volume.spacing);
         // ArcballCamera arcballCamera(worldBound, imgSize);
         // vec3f cam_pos = vec3f{200.f, 0.f, 0.f};
-        vec2f range = vec2f{-2.92272, 0.407719};
 
         // std::cout << "camera pos " << arcballCamera.eyePos() << std::endl;
         // std::cout << "camera look dir " << arcballCamera.lookDir() << std::endl;
         // std::cout << "camera up dir " << arcballCamera.upDir() << std::endl;
         {
-            // //! Transfer function
-            const std::string colormap = "jet";
-            ospray::cpp::TransferFunction transfer_function = makeTransferFunction(colormap, range);
-
-            //! Volume
-            ospray::cpp::Volume osp_volume = createStructuredVolume(volume);
-            //! Volume Model
-            ospray::cpp::VolumetricModel volume_model(osp_volume);
-            volume_model.setParam("transferFunction", transfer_function);
-            volume_model.commit();
-            // put the model into a group (collection of models)
-            ospray::cpp::Group group;
-            group.setParam("volume", ospray::cpp::CopiedData(volume_model));
-            group.commit();
-            // put the group into an instance (give the group a world transform)
-            ospray::cpp::Instance instance(group);
-            instance.commit();
-
-            // put the instance in the world
-            ospray::cpp::World world;
-            world.setParam("instance", ospray::cpp::CopiedData(instance));
-
-            // create and setup light for Ambient Occlusion
-            ospray::cpp::Light light("ambient");
-            light.commit();
-
-            world.setParam("light", ospray::cpp::CopiedData(light));
-            world.commit();
-
-            // create renderer, choose Scientific Visualization renderer
-            ospray::cpp::Renderer renderer("scivis");
-
-            // complete setup of renderer
-            renderer.setParam("aoSamples", 0);
-            renderer.setParam("pixelSamples", 10);
-            renderer.setParam("backgroundColor", 1.0f); // white, transparent
-            renderer.commit();
-
-            // create and setup framebuffer
-            ospray::cpp::FrameBuffer framebuffer(imgSize.x, imgSize.y, OSP_FB_SRGBA, OSP_FB_COLOR | OSP_FB_ACCUM);
-            framebuffer.clear();
-
-            for(int i = 0; i < cameras.size(); i++){
-                framebuffer.clear();
-                //create and setup camera
-                ospray::cpp::Camera camera("perspective");
-                camera.setParam("aspect", imgSize.x / (float)imgSize.y);
-                camera.setParam("position", cameras[i].pos);
-                camera.setParam("direction", cameras[i].dir);
-                camera.setParam("up", cameras[i].up);
-                camera.commit(); // commit each object to indicate modifications are done
-                // render 10 more frames, which are accumulated to result in a better
-                // converged image
-                for (int frames = 0; frames < 100; frames++)
-                    framebuffer.renderFrame(renderer, camera, world);
-
-                uint32_t *fb = (uint32_t *)framebuffer.map(OSP_FB_COLOR);
-                // std::cout << "file dir " << f.fileDir << std::endl;
-                std::string filename = "volume_ts" + std::to_string(f.timeStep)+ "_cam" + std::to_string(i)  + ".jpg";
-                // + "_" + std::to_string(index)
-                // std::cout << filename << std::endl;
-                stbi_write_jpg(filename.c_str(), imgSize.x, imgSize.y, 4, fb, 100);
-                framebuffer.unmap(fb);
-                // index++;
+            if(!scene){
+                const std::string colormap = "jet";
+                scene.reset(new VolumeScene(volume, imgSize, colormap, range,
+                                            args.variance_threshold > 0.f,
+                                            n_framebuffers));
+                scene->setFramesPerLaunch(frames_per_launch);
+            }else{
+                scene->setVolume(volume);
+            }
+            // the views of this timestep still to render, in render order
+            std::vector<int> views;
+            const auto cams = camera_range(shard_file_index[file_index]);
+            for(size_t k = cams.first; k < cams.second; k++){
+                if(!job_done(f.timeStep, camera_order[k]))
+                    views.push_back(camera_order[k]);
             }
 
+            // every framebuffer/camera pair of the scene accumulates its own
+            // view, they all render concurrently and take views from a
+            // work-stealing queue until the timestep is done
+            auto set_view = [&](const int slot, const size_t view){
+                const Camera &c = cameras[views[view]];
+                ospray::cpp::Camera &camera = scene->cameras[slot];
+                camera.setParam("position", c.pos);
+                camera.setParam("direction", c.dir);
+                camera.setParam("up", c.up);
+                camera.setParam("fovy", c.fovy);
+                camera.commit(); // commit each object to indicate modifications are done
+            };
+            auto finish = [&](const int slot, const size_t view, const int frames){
+                const int i = views[view];
+                const std::string filename = image_name(f.timeStep, i);
+                ospray::cpp::FrameBuffer &framebuffer = scene->framebuffers[slot];
+                TraceScope scope(dataset ? "map_append" : "map_copy");
+                uint32_t *fb = (uint32_t *)framebuffer.map(OSP_FB_COLOR);
+                if(dataset){
+                    const Camera &c = cameras[i];
+                    const int tf = 0;
+                    dataset->append(fb, f.timeStep, i, tf, c.pos, c.dir, c.up, c.fovy);
+                    framebuffer.unmap(fb);
+                }else{
+                    auto pixels = std::make_shared<std::vector<uint32_t>>(fb, fb + imgSize.x * imgSize.y);
+                    framebuffer.unmap(fb);
+                    const int timestep = f.timeStep;
+                    writer.write(filename, ImageFormat::JPG, imgSize, pixels,
+                                 [&journal, timestep, i](){ journal->record(timestep, i); });
+                }
+                std::cout << filename << " frames: " << frames << "\n";
+                Tracer::instance().countImage();
+                ++total_images;
+            };
+            // accumulate frames until the image converged (with
+            // -variance-threshold) or -max-frames are rendered; all views
+            // are done when this returns, so the volume can be swapped next
+            total_frames += renderViews(*scene, views.size(), args.max_frames,
+                                        args.variance_threshold, frames_per_launch,
+                                        set_view, finish);
         }
+        ++file_index;
+    }
+    scene.reset();
+    if(dataset){
+        dataset->close();
+    }
+    dataset.reset();
+    writer.finish();
+    journal.reset();
+    writer.printStats(std::cout);
+    if(total_images > 0){
+        std::cout << "average frames per image: "
+                  << total_frames / double(total_images) << std::endl;
     }
+    Tracer::instance().printSummary(std::cout);
+    Tracer::instance().finishTrace();
     ospShutdown();
     
 
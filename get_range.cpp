@@ -4,13 +4,14 @@
 
 #include "parseArgs.h"
 #include "load_raw.h"
+#include "series_stats.h"
 #include <ospray/ospray_cpp.h>
 #include "ospray/ospray_cpp/ext/rkcommon.h"
 
 using namespace rkcommon::math;
 const std::string voxel_type = "float32";
 
-// Load all files and calculate the range of 
+// Stream over all files and calculate the range of 
 // entire time series for generating transfer function 
 
 int main(int argc, const char **argv)
@@ -20,47 +21,20 @@ int main(int argc, const char **argv)
     parseArgs(argc, argv, args);
 
     // load data
-    std::vector<timesteps> files;
-    for(const auto &dir : args.timeStepPaths){
-        DIR *dp = opendir(dir.c_str());
-        if (!dp) {
-            throw std::runtime_error("failed to open directory: " + dir);
-        }
-        for(dirent *e = readdir(dp); e; e = readdir(dp)){
-            std::string name = e ->d_name;
-            if(name.length() > 3){
-                const int timestep = std::stoi(name.substr(10, name.find(".") - 10));
-                const std::string filename = dir + "/" + name;
-                // std::cout << filename << " " << timestep << std::endl;
-                timesteps t(timestep, filename);
-                files.push_back(t);
-            }
-        }
-    }
-    // Sort time steps 
-    std::sort(files.begin(), files.end(), sort_timestep());
-    // load volumes 
-    std::vector<Volume> volumes;
+    const std::vector<timesteps> files = scan_timestep_files(args.timeStepPaths);
+    // load, reduce and discard one timestep at a time on a pool of loader
+    // threads, timesteps with a <file>.stats cache are not read at all
     const vec3i dims{args.dims, args.dims, args.dims};
+    const std::vector<VolumeStats> stats =
+        load_series_stats(files, dims, voxel_type, args.use_mmap, args.threads,
+                          size_t(args.stats_mem) << 20);
+    const vec2f range = global_range(stats);
 
-    int count = 500;
-    for(auto f : files){
-        // if(f.timeStep % count == 0){
-            volumes.push_back(load_raw_volume(f.fileDir, dims, voxel_type));
-        // }
-    }    
-
-    box3f worldBound = box3f(-dims / 2 * volumes[0].spacing, dims / 2 * volumes[0].spacing);
-    vec2f range; 
-    Volume &temp1 = *std::min_element(volumes.begin(), volumes.end(), [](Volume &v1, Volume &v2){
-        return v1.range.x < v2.range.x;
-    });
-    Volume &temp2 = *std::max_element(volumes.begin(), volumes.end(), [](Volume &v1, Volume &v2){
-        return v1.range.y > v2.range.y;
-    });
-    range.x = temp1.range.x; range.y = temp2.range.y;
     std::cout << "global range: " << range << std::endl;
+    if(args.has_range_percentile){
+        std::cout << "percentile range " << args.range_percentile << ": "
+                  << series_range(stats, args) << std::endl;
+    }
 
-
-
-}
\ No newline at end of file
+    return 0;
+}
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "rkcommon/math/vec.h"
+#include "stb_image_write.h"
+#include "trace.h"
+
+using namespace rkcommon::math;
+
+enum class ImageFormat { JPG, PNG };
+
+// Encodes and writes RGBA8 images on a pool of worker threads, so the render
+// thread only pays for copying the framebuffer out. The pixels are shared, so
+// writing one image in several formats does not copy it again.
+//
+// At most max_queue images wait for a worker; write() blocks beyond that so a
+// renderer outpacing the encoders cannot grow memory without bound. Queued
+// images are all written by finish(), which the destructor also calls.
+// on_written, if given, runs on the worker thread once the file is written.
+// The file is not flushed to disk, ProgressJournal syncs the images of a
+// batch before journaling it.
+class ImageWriter
+{
+ public:
+  ImageWriter(const int n_threads, const size_t max_queue = 64);
+  ~ImageWriter();
+
+  void finish();
+  // encode times per format and queue behaviour, call after finish()
+  void printStats(std::ostream &os) const;
+
+  ImageWriter(const ImageWriter &) = delete;
+  ImageWriter &operator=(const ImageWriter &) = delete;
+
+  void write(const std::string &filename,
+             const ImageFormat format,
+             const vec2i &size,
+             const std::shared_ptr<const std::vector<uint32_t>> &pixels,
+             const std::function<void()> &on_written = nullptr);
+
+ private:
+  struct Job
+  {
+    std::string filename;
+    ImageFormat format;
+    vec2i size;
+    std::shared_ptr<const std::vector<uint32_t>> pixels;
+    std::function<void()> on_written;
+  };
+
+  struct FormatStats
+  {
+    size_t images = 0;
+    double encode_seconds = 0.0;
+  };
+
+  void run();
+
+  size_t max_queue;
+  std::mutex mutex;
+  std::condition_variable cond;
+  std::condition_variable space;
+  std::deque<Job> jobs;
+  bool stop = false;
+  std::vector<std::thread> workers;
+
+  FormatStats stats[2];
+  size_t enqueued = 0;
+  size_t summed_depth = 0;
+  size_t max_depth = 0;
+  double blocked_seconds = 0.0;
+};
+
+ImageWriter::ImageWriter(const int n_threads, const size_t max_queue)
+    : max_queue(std::max(max_queue, size_t(1)))
+{
+  for (int i = 0; i < std::max(n_threads, 1); ++i) {
+    workers.emplace_back([this]() { run(); });
+  }
+}
+
+ImageWriter::~ImageWriter()
+{
+  finish();
+}
+
+void ImageWriter::finish()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stop = true;
+  }
+  cond.notify_all();
+  for (auto &w : workers) {
+    w.join();
+  }
+  workers.clear();
+}
+
+void ImageWriter::printStats(std::ostream &os) const
+{
+  const char *names[2] = {"jpg", "png"};
+  for (int i = 0; i < 2; ++i) {
+    if (stats[i].images == 0) {
+      continue;
+    }
+    os << names[i] << ": " << stats[i].images << " images, "
+       << 1000.0 * stats[i].encode_seconds / stats[i].images << " ms/image encode\n";
+  }
+  if (enqueued > 0) {
+    os << "encode queue depth: avg " << summed_depth / double(enqueued) << ", max "
+       << max_depth << " of " << max_queue << ", render thread blocked "
+       << blocked_seconds << " s" << std::endl;
+  }
+}
+
+void ImageWriter::write(const std::string &filename,
+                        const ImageFormat format,
+                        const vec2i &size,
+                        const std::shared_ptr<const std::vector<uint32_t>> &pixels,
+                        const std::function<void()> &on_written)
+{
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (jobs.size() >= max_queue) {
+      const auto start = std::chrono::steady_clock::now();
+      space.wait(lock, [&]() { return jobs.size() < max_queue; });
+      blocked_seconds += std::chrono::duration<double>(
+          std::chrono::steady_clock::now() - start).count();
+    }
+    jobs.push_back(Job{filename, format, size, pixels, on_written});
+    ++enqueued;
+    summed_depth += jobs.size();
+    max_depth = std::max(max_depth, jobs.size());
+  }
+  cond.notify_one();
+}
+
+void ImageWriter::run()
+{
+  while (true) {
+    Job job;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      cond.wait(lock, [&]() { return stop || !jobs.empty(); });
+      if (jobs.empty()) {
+        return;
+      }
+      job = std::move(jobs.front());
+      jobs.pop_front();
+    }
+    space.notify_one();
+
+    const auto start = std::chrono::steady_clock::now();
+    bool ok = false;
+    if (job.format == ImageFormat::PNG) {
+      ok = stbi_write_png(job.filename.c_str(), job.size.x, job.size.y, 4,
+                          job.pixels->data(), job.size.x * 4) != 0;
+    } else {
+      ok = stbi_write_jpg(job.filename.c_str(), job.size.x, job.size.y, 4,
+                          job.pixels->data(), 100) != 0;
+    }
+    const auto end = std::chrono::steady_clock::now();
+    const double seconds = std::chrono::duration<double>(end - start).count();
+    Tracer::instance().record(job.format == ImageFormat::PNG ? "encode_png" : "encode_jpg", start, end);
+    if (!ok) {
+      std::cerr << "Failed to write " << job.filename << std::endl;
+    } else if (job.on_written) {
+      job.on_written();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    FormatStats &format_stats = stats[job.format == ImageFormat::PNG ? 1 : 0];
+    ++format_stats.images;
+    format_stats.encode_seconds += seconds;
+  }
+}
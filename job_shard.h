@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+
+// One of `count` slices of the (timestep x camera) job space, so that the
+// images of a series can be rendered by several processes or nodes. Job j is
+// (timestep j / n_cameras, camera j % n_cameras) in render order, and shard i
+// takes the contiguous jobs [i * n / count, (i + 1) * n / count): every shard
+// loads as few timesteps as possible and the slices are identical wherever
+// they are computed.
+struct JobShard {
+    int index = 0;
+    int count = 1;
+};
+
+struct JobRange {
+    uint64_t begin = 0;
+    uint64_t end = 0;
+};
+
+// parse "i/N"
+JobShard parse_job_shard(const std::string &s)
+{
+    JobShard shard;
+    char tail = 0;
+    if (std::sscanf(s.c_str(), "%d/%d%c", &shard.index, &shard.count, &tail) != 2
+        || shard.count < 1 || shard.index < 0 || shard.index >= shard.count) {
+        throw std::runtime_error("Invalid shard " + s + ", expected i/N with 0 <= i < N");
+    }
+    return shard;
+}
+
+JobRange job_range(const uint64_t n_jobs, const JobShard &shard)
+{
+    JobRange range;
+    range.begin = n_jobs * shard.index / shard.count;
+    range.end = n_jobs * (shard.index + 1) / shard.count;
+    return range;
+}
+
+// the output prefix a shard writes its part of a dataset to
+std::string shard_prefix(const std::string &prefix, const JobShard &shard)
+{
+    if (shard.count == 1) {
+        return prefix;
+    }
+    char suffix[32];
+    std::snprintf(suffix, sizeof(suffix), ".part%04d", shard.index);
+    return prefix + suffix;
+}
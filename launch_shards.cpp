@@ -0,0 +1,193 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <sched.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "job_shard.h"
+#include "parseArgs.h"
+#include "series_stats.h"
+#include "shard_writer.h"
+
+// Runs a renderer as N local worker processes, each rendering one -shard i/N
+// of the jobs with its own OSPRay device pinned to its own block of cores,
+// then merges the -dataset parts of the workers into one dataset.
+//
+// Without -range the transfer function range of the -multi-ts series is
+// computed once here and passed on with -range, instead of every worker
+// reading the whole series for it.
+//
+//   launch_shards 4 ./gen_images -dims 512 -multi-ts data -dataset out/ds
+//
+// Workers on other nodes of a shared filesystem are started by hand with
+// -shard i/N, their parts are merged afterwards with
+//
+//   launch_shards -merge out/ds N
+
+int read_topology(const int cpu, const std::string &field)
+{
+    std::ifstream fin("/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/" + field);
+    int value = 0;
+    fin >> value;
+    return value;
+}
+
+// the CPUs this process may run on, ordered by (socket, core) so that
+// contiguous blocks of the list stay on one socket and keep SMT siblings
+// together
+std::vector<int> ordered_cpus()
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    sched_getaffinity(0, sizeof(set), &set);
+    std::vector<std::tuple<int, int, int>> cpus;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &set)) {
+            cpus.emplace_back(read_topology(cpu, "physical_package_id"),
+                              read_topology(cpu, "core_id"),
+                              cpu);
+        }
+    }
+    std::sort(cpus.begin(), cpus.end());
+    std::vector<int> ordered;
+    for (const auto &c : cpus) {
+        ordered.push_back(std::get<2>(c));
+    }
+    return ordered;
+}
+
+// The -range lo hi arguments for the workers, empty if the renderer gets a
+// range already or has no -multi-ts series
+std::vector<std::string> series_range_args(const int argc, const char **argv)
+{
+    Args args;
+    parseArgs(argc, argv, args);
+    if (args.has_range || args.timeStepPaths.empty() || args.dims <= 0) {
+        return {};
+    }
+    const vec3i dims{args.dims, args.dims, args.dims};
+    const vec2f range = series_range(load_series_stats(scan_timestep_files(args.timeStepPaths),
+                                                       dims,
+                                                       "float32",
+                                                       args.use_mmap,
+                                                       args.threads,
+                                                       size_t(args.stats_mem) << 20),
+                                     args);
+    std::cout << "transfer function range: " << range << std::endl;
+    // %.9g round-trips the floats exactly
+    char lo[32], hi[32];
+    std::snprintf(lo, sizeof(lo), "%.9g", range.x);
+    std::snprintf(hi, sizeof(hi), "%.9g", range.y);
+    return {"-range", lo, hi};
+}
+
+void merge_dataset(const std::string &prefix, const int n_parts)
+{
+    std::vector<std::string> parts;
+    for (int i = 0; i < n_parts; ++i) {
+        JobShard shard;
+        shard.index = i;
+        shard.count = n_parts;
+        parts.push_back(shard_prefix(prefix, shard));
+    }
+    merge_shard_datasets(prefix, parts);
+    std::cout << "merged " << n_parts << " parts into " << prefix << ".idx" << std::endl;
+}
+
+int main(int argc, const char **argv)
+{
+    if (argc == 4 && std::string(argv[1]) == "-merge") {
+        merge_dataset(argv[2], std::atoi(argv[3]));
+        return 0;
+    }
+    if (argc < 3) {
+        std::cerr << "usage: " << argv[0] << " <n_workers> <renderer> [renderer args...]\n"
+                  << "       " << argv[0] << " -merge <dataset prefix> <n_parts>" << std::endl;
+        return 1;
+    }
+    const int n_workers = std::atoi(argv[1]);
+    if (n_workers < 1) {
+        std::cerr << "the number of workers must be at least 1" << std::endl;
+        return 1;
+    }
+    std::string dataset;
+    for (int i = 3; i + 1 < argc; ++i) {
+        if (std::string(argv[i]) == "-dataset") {
+            dataset = argv[i + 1];
+        }
+    }
+
+    const std::vector<std::string> range_args = series_range_args(argc - 2, argv + 2);
+
+    const std::vector<int> cpus = ordered_cpus();
+    std::vector<pid_t> workers;
+    for (int w = 0; w < n_workers; ++w) {
+        const size_t cpu_begin = cpus.size() * w / n_workers;
+        const size_t cpu_end = cpus.size() * (w + 1) / n_workers;
+        const std::string shard = std::to_string(w) + "/" + std::to_string(n_workers);
+
+        const pid_t pid = fork();
+        if (pid < 0) {
+            std::cerr << "failed to start worker " << shard << std::endl;
+            break;
+        }
+        if (pid == 0) {
+            // pin before exec, OSPRay sizes its thread pool to the affinity
+            // mask and first-touch places the volumes on the local node
+            if (cpu_end > cpu_begin) {
+                cpu_set_t set;
+                CPU_ZERO(&set);
+                for (size_t c = cpu_begin; c < cpu_end; ++c) {
+                    CPU_SET(cpus[c], &set);
+                }
+                sched_setaffinity(0, sizeof(set), &set);
+                setenv("OSPRAY_NUM_THREADS", std::to_string(cpu_end - cpu_begin).c_str(), 1);
+            }
+            std::vector<const char *> worker_argv(argv + 2, argv + argc);
+            for (const auto &a : range_args) {
+                worker_argv.push_back(a.c_str());
+            }
+            worker_argv.push_back("-shard");
+            worker_argv.push_back(shard.c_str());
+            worker_argv.push_back(nullptr);
+            execvp(worker_argv[0], const_cast<char *const *>(worker_argv.data()));
+            std::cerr << "failed to run " << worker_argv[0] << std::endl;
+            _exit(127);
+        }
+        std::cout << "worker " << shard << " (pid " << pid << "): "
+                  << cpu_end - cpu_begin << " cpus" << std::endl;
+        workers.push_back(pid);
+    }
+
+    int failed = n_workers - int(workers.size());
+    for (const pid_t pid : workers) {
+        int status = 0;
+        if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            std::cerr << "worker " << pid << " failed" << std::endl;
+            ++failed;
+        }
+    }
+    if (failed > 0) {
+        std::cerr << failed << " of " << n_workers << " workers failed";
+        if (!dataset.empty()) {
+            std::cerr << ", the dataset parts were left unmerged";
+        }
+        std::cerr << std::endl;
+        return 1;
+    }
+    // a single worker writes the dataset under its own prefix already
+    if (!dataset.empty() && n_workers > 1) {
+        merge_dataset(dataset, n_workers);
+    }
+    return 0;
+}
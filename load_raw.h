@@ -1,7 +1,16 @@
 #pragma once 
 
 #include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <memory>
+#include <cstring>
+#include <vector>
 #include "rkcommon/math/vec.h"
+#include "mapped_file.h"
+#include "volume_stats.h"
+#include "stats_cache.h"
+#include "trace.h"
 
 using namespace rkcommon::math;
 
@@ -17,19 +26,87 @@ timesteps::timesteps(const int timeStep, const std::string &fileDir)
     : timeStep(timeStep), fileDir(fileDir)
 {}
 
+enum class VoxelType { UINT8, UINT16, HALF, FLOAT32, FLOAT64 };
+
+VoxelType parse_voxel_type(const std::string &voxel_type)
+{
+    if (voxel_type == "uint8") {
+        return VoxelType::UINT8;
+    } else if (voxel_type == "uint16") {
+        return VoxelType::UINT16;
+    } else if (voxel_type == "float16" || voxel_type == "half") {
+        return VoxelType::HALF;
+    } else if (voxel_type == "float32") {
+        return VoxelType::FLOAT32;
+    } else if (voxel_type == "float64") {
+        return VoxelType::FLOAT64;
+    }
+    throw std::runtime_error("Unrecognized voxel type " + voxel_type);
+}
+
+size_t voxel_size(const VoxelType type)
+{
+    switch (type) {
+    case VoxelType::UINT8:
+        return 1;
+    case VoxelType::UINT16:
+    case VoxelType::HALF:
+        return 2;
+    case VoxelType::FLOAT32:
+        return 4;
+    default:
+        return 8;
+    }
+}
+
 struct Volume {
     vec3i dims;
     vec2f range;
+    VolumeStats stats;
     vec3f spacing{1.f};
     vec3f origin{0.f};
-    std::shared_ptr<std::vector<float>> voxel_data = nullptr;
+    // voxels are kept in their on-disk type, OSPRay reads them natively
+    VoxelType voxel_type = VoxelType::FLOAT32;
+    std::shared_ptr<std::vector<uint8_t>> voxel_data = nullptr;
+    // set instead of voxel_data when the voxels are used straight from the file
+    std::shared_ptr<MappedFile> mapped_data = nullptr;
 
     size_t n_voxels() const
     {
         return size_t(dims.x) * size_t(dims.y) * size_t(dims.z);
     }
+
+    size_t n_bytes() const
+    {
+        return n_voxels() * voxel_size(voxel_type);
+    }
+
+    const void *data() const
+    {
+        if (mapped_data) {
+            return mapped_data->addr;
+        }
+        return voxel_data->data();
+    }
 };
 
+VolumeStats compute_stats(const Volume &volume)
+{
+    const size_t n = volume.n_voxels();
+    switch (volume.voxel_type) {
+    case VoxelType::UINT8:
+        return compute_volume_stats(static_cast<const uint8_t *>(volume.data()), n, AsFloat());
+    case VoxelType::UINT16:
+        return compute_volume_stats(static_cast<const uint16_t *>(volume.data()), n, AsFloat());
+    case VoxelType::HALF:
+        return compute_volume_stats(static_cast<const uint16_t *>(volume.data()), n, HalfToFloat());
+    case VoxelType::FLOAT32:
+        return compute_volume_stats(static_cast<const float *>(volume.data()), n, AsFloat());
+    default:
+        return compute_volume_stats(static_cast<const double *>(volume.data()), n, AsFloat());
+    }
+}
+
 struct sort_timestep
 {
     inline bool operator() (const timesteps &a, const timesteps &b) {
@@ -37,73 +114,73 @@ struct sort_timestep
     }
 };
 
-Volume load_raw_volume(const std::string &fname,
-                       const vec3i &dims,
-                       const std::string &voxel_type)
+// Map a volume without staging it through a read buffer
+Volume map_raw_volume(const std::string &fname,
+                      const vec3i &dims,
+                      const VoxelType voxel_type)
 {
     Volume volume;
     volume.dims = dims;
+    volume.voxel_type = voxel_type;
+    volume.mapped_data = std::make_shared<MappedFile>(fname);
+    if (volume.mapped_data->size < volume.n_bytes()) {
+        throw std::runtime_error("Volume " + fname + " is smaller than its dims");
+    }
+    return volume;
+}
 
-    size_t voxel_size = 0;
-    if (voxel_type == "uint8") {
-        voxel_size = 1;
-    } else if (voxel_type == "uint16") {
-        voxel_size = 2;
-    } else if (voxel_type == "float32") {
-        voxel_size = 4;
-    } else if (voxel_type == "float64") {
-        voxel_size = 8;
+// Reads (or with use_mmap maps) a raw volume and its statistics, from the
+// stats cache if there is one. Computed statistics are written to the cache
+// unless write_cache is false, the range is printed with verbose.
+Volume load_raw_volume(const std::string &fname,
+                       const vec3i &dims,
+                       const std::string &voxel_type,
+                       const bool use_mmap = false,
+                       const bool write_cache = true,
+                       const bool verbose = false)
+{
+    Volume volume;
+    const Tracer::clock::time_point load_start = Tracer::clock::now();
+    if (use_mmap) {
+        volume = map_raw_volume(fname, dims, parse_voxel_type(voxel_type));
     } else {
-        throw std::runtime_error("Unrecognized voxel type " + voxel_type);
-    }
+        volume.dims = dims;
+        volume.voxel_type = parse_voxel_type(voxel_type);
 
-    std::ifstream fin(fname.c_str(), std::ios::binary);
-    auto voxel_data = std::make_shared<std::vector<uint8_t>>(volume.n_voxels() * voxel_size, 0);
+        std::ifstream fin(fname.c_str(), std::ios::binary);
+        volume.voxel_data = std::make_shared<std::vector<uint8_t>>(volume.n_bytes(), 0);
 
-    if (!fin.read(reinterpret_cast<char *>(voxel_data->data()), voxel_data->size())) {
-        throw std::runtime_error("Failed to read volume " + fname);
+        if (!fin.read(reinterpret_cast<char *>(volume.voxel_data->data()), volume.voxel_data->size())) {
+            throw std::runtime_error("Failed to read volume " + fname);
+        }
     }
+    Tracer::instance().record("load_volume", load_start, Tracer::clock::now());
 
-    volume.voxel_data = std::make_shared<std::vector<float>>(volume.n_voxels(), 0.f);
-
-    // Temporarily convert non-float data to float
-    // TODO will native support for non-float voxel types
-    if (voxel_type == "uint8") {
-        std::transform(voxel_data->begin(),
-                       voxel_data->end(),
-                       volume.voxel_data->begin(),
-                       [](const uint8_t &x) { return float(x); });
-    } else if (voxel_type == "uint16") {
-        std::transform(reinterpret_cast<uint16_t *>(voxel_data->data()),
-                       reinterpret_cast<uint16_t *>(voxel_data->data()) + volume.n_voxels(),
-                       volume.voxel_data->begin(),
-                       [](const uint16_t &x) { return float(x); });
-    } else if (voxel_type == "float32") {
-        std::transform(reinterpret_cast<float *>(voxel_data->data()),
-                       reinterpret_cast<float *>(voxel_data->data()) + volume.n_voxels(),
-                       volume.voxel_data->begin(),
-                       [](const float &x) { return x; });
-    } else {
-        std::transform(reinterpret_cast<double *>(voxel_data->data()),
-                       reinterpret_cast<double *>(voxel_data->data()) + volume.n_voxels(),
-                       volume.voxel_data->begin(),
-                       [](const uint16_t &x) { return float(x); });
+    // find the range and value distribution, or reuse them from <fname>.stats
+    if (!read_stats_cache(fname, dims, voxel_type, volume.stats)) {
+        TraceScope scope("volume_stats");
+        volume.stats = compute_stats(volume);
+        if (write_cache) {
+            write_stats_cache(fname, dims, voxel_type, volume.stats);
+        }
     }
-    
-    // find the range
-    volume.range.x = *std::min_element(volume.voxel_data->begin(), volume.voxel_data->end());
-    volume.range.y = *std::max_element(volume.voxel_data->begin(), volume.voxel_data->end());
-    std::cout << "volume range: " << volume.range << std::endl;
-    // float b = 1.f / (volume.range.y - volume.range.x) * 255.f;
-    // std::vector<float> &voxels = *volume.voxel_data;
-    // for(int i = 0; i < volume.n_voxels(); ++i){
-    //     float a = (voxels[i] - volume.range.x) * b;
-    //     voxels[i] = a;
-    // }
-    // volume.range.x = *std::min_element(volume.voxel_data->begin(), volume.voxel_data->end());
-    // volume.range.y = *std::max_element(volume.voxel_data->begin(), volume.voxel_data->end());
-    // std::cout << "volume range: " << volume.range << std::endl;
-
- 
+    volume.range = volume.stats.range;
+    if (verbose) {
+        std::cout << "volume range: " << volume.range << std::endl;
+    }
+
     return volume;
-}
\ No newline at end of file
+}
+
+// Statistics of a raw volume, only read from disk if not cached yet
+VolumeStats load_volume_stats(const std::string &fname,
+                              const vec3i &dims,
+                              const std::string &voxel_type,
+                              const bool use_mmap = false)
+{
+    VolumeStats stats;
+    if (read_stats_cache(fname, dims, voxel_type, stats)) {
+        return stats;
+    }
+    return load_raw_volume(fname, dims, voxel_type, use_mmap).stats;
+}
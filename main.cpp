@@ -54,7 +54,7 @@ int main(int argc, const char **argv)
         }
         for(dirent *e = readdir(dp); e; e = readdir(dp)){
             std::string name = e ->d_name;
-            if(name.length() > 3){
+            if(name.length() > 3 && !is_stats_cache_file(name)){
                 const int timestep = std::stoi(name.substr(6, name.find(".") - 6));
                 const std::string filename = dir + "/" + name;
                 // std::cout << filename << " " << timestep << std::endl;
@@ -72,7 +72,7 @@ int main(int argc, const char **argv)
     int count = 3;
     for(auto f : files){
         if(f.timeStep % count == 0){
-            volumes.push_back(load_raw_volume(f.fileDir, dims, voxel_type));
+            volumes.push_back(load_raw_volume(f.fileDir, dims, voxel_type, false, true, args.verbose));
         }
     }    
 
@@ -106,14 +106,15 @@ int main(int argc, const char **argv)
 
     // use scoped lifetimes of wrappers to release everything before ospShutdown()
     {
+        // create and setup camera, the view is the same for every volume
+        ospray::cpp::Camera camera("perspective");
+        camera.setParam("aspect", imgSize.x / (float)imgSize.y);
+        camera.setParam("position", cam_pos);
+        camera.setParam("direction", cam_view);
+        camera.setParam("up", cam_up);
+        camera.commit(); // commit each object to indicate modifications are done
+
         for(int i = 0; i < volumes.size(); i++){
-            // create and setup camera
-            ospray::cpp::Camera camera("perspective");
-            camera.setParam("aspect", imgSize.x / (float)imgSize.y);
-            camera.setParam("position", cam_pos);
-            camera.setParam("direction", cam_view);
-            camera.setParam("up", cam_up);
-            camera.commit(); // commit each object to indicate modifications are done
 
             // //! Transfer function
             const std::string colormap = "jet";
@@ -8,19 +8,53 @@
 #include "rkcommon/math/box.h"
 
 #include "load_raw.h"
+#include "trace.h"
 
 using namespace rkcommon::math;
 
-ospray::cpp::Volume createStructuredVolume(const Volume volume)
+OSPDataType osp_voxel_type(const VoxelType type)
+{
+  switch (type) {
+  case VoxelType::UINT8:
+    return OSP_UCHAR;
+  case VoxelType::UINT16:
+    return OSP_USHORT;
+  case VoxelType::HALF:
+    return OSP_HALF;
+  case VoxelType::FLOAT32:
+    return OSP_FLOAT;
+  default:
+    return OSP_DOUBLE;
+  }
+}
+
+// Points osp_volume at the voxels of volume and commits it. The voxels are
+// shared with OSPRay rather than copied, so the Volume (or any copy of it,
+// which shares the same storage) has to stay alive for as long as the OSPRay
+// volume is rendered.
+void setStructuredVolumeData(ospray::cpp::Volume &osp_volume, const Volume &volume)
+{
+  TraceScope scope("volume_data");
+  // the typed C API is used because the C++ wrappers only know the element
+  // type at compile time
+  OSPData voxels = ospNewSharedData3D(volume.data(),
+                                      osp_voxel_type(volume.voxel_type),
+                                      volume.dims.x,
+                                      volume.dims.y,
+                                      volume.dims.z);
+  osp_volume.setParam("data", voxels);
+  osp_volume.commit();
+  ospRelease(voxels);
+}
+
+ospray::cpp::Volume createStructuredVolume(const Volume &volume)
 {
   ospray::cpp::Volume osp_volume("structuredRegular");
 
-  auto voxels = *(volume.voxel_data);
 // vec3f(-volume.dims.x/ 2.f, -volume.dims.y/2.f, -volume.dims.z/2.f)
   osp_volume.setParam("gridOrigin", vec3f(0.f));
   osp_volume.setParam("gridSpacing", vec3f(1.f));
-  osp_volume.setParam("data", ospray::cpp::CopiedData(voxels.data(), volume.dims));
-  osp_volume.commit();
+  setStructuredVolumeData(osp_volume, volume);
   return osp_volume;
 }
 
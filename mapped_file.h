@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stdexcept>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Read-only mapping of a file, used for raw volumes and camera files. The
+// pages are hinted for sequential read ahead when mapped and dropped from the
+// page cache again when the mapping is destroyed, so streaming through a long
+// time series does not evict everything else on the node.
+struct MappedFile {
+    int fd = -1;
+    void *addr = nullptr;
+    size_t size = 0;
+
+    MappedFile(const std::string &fname);
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+};
+
+MappedFile::MappedFile(const std::string &fname)
+{
+    fd = open(fname.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open " + fname);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        throw std::runtime_error("Failed to stat (or empty) " + fname);
+    }
+    size = size_t(st.st_size);
+    addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr == MAP_FAILED) {
+        close(fd);
+        throw std::runtime_error("Failed to map " + fname);
+    }
+    madvise(addr, size, MADV_SEQUENTIAL);
+    madvise(addr, size, MADV_WILLNEED);
+}
+
+MappedFile::~MappedFile()
+{
+    madvise(addr, size, MADV_DONTNEED);
+    munmap(addr, size);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
@@ -1,9 +1,16 @@
 #pragma once
 
 
+#include <cstdint>
+#include <cstdlib>
 #include <iostream>
 #include <vector>
 
+#include "rkcommon/math/vec.h"
+#include "job_shard.h"
+
+using namespace rkcommon::math;
+
 struct Args
 {
     std::string extension;
@@ -17,6 +24,36 @@ struct Args
     int timeStep = 0;
     int dims = 0;
     int n_samples = 100;
+    uint64_t seed = 0;
+    bool use_mmap = false;
+    int prefetch = 1;
+    int prefetch_mem = 0;
+    int max_frames = 100;
+    float variance_threshold = 0.f;
+    // framebuffer/camera pairs rendering views concurrently
+    int fb_ring = 8;
+    // frames of one view accumulated per renderFrame call, views are never
+    // batched together; with -variance-threshold a view can then only stop
+    // after a whole launch
+    int frames_per_view_launch = 1;
+    int encode_threads = 2;
+    int encode_queue = 64;
+    std::string dataset;
+    int dataset_shard_mb = 1024;
+    bool dataset_rgb = false;
+    int threads = 0;
+    int stats_mem = 0;
+    bool has_range = false;
+    vec2f range;
+    bool has_range_percentile = false;
+    vec2f range_percentile;
+    std::string camera_file = "input.txt";
+    bool camera_order = false;
+    JobShard shard;
+    std::string journal;
+    std::string trace;
+    bool resume = false;
+    bool verbose = false;
 };
 
 std::string getFileExt(const std::string& s) 
@@ -53,6 +90,58 @@ void parseArgs(int argc, const char **argv, Args &args)
             args.dims = std::atoi(argv[++i]);
         }else if(arg == "-n_samples"){
             args.n_samples = std::atoi(argv[++i]);
+        }else if(arg == "-seed"){
+            args.seed = std::strtoull(argv[++i], nullptr, 10);
+        }else if(arg == "-mmap"){
+            args.use_mmap = true;
+        }else if(arg == "-prefetch"){
+            args.prefetch = std::atoi(argv[++i]);
+        }else if(arg == "-prefetch-mem"){
+            args.prefetch_mem = std::atoi(argv[++i]);
+        }else if(arg == "-max-frames"){
+            args.max_frames = std::atoi(argv[++i]);
+        }else if(arg == "-variance-threshold"){
+            args.variance_threshold = std::atof(argv[++i]);
+        }else if(arg == "-fb-ring" || arg == "-views-in-flight"){
+            args.fb_ring = std::atoi(argv[++i]);
+        }else if(arg == "-frames-per-view-launch"){
+            args.frames_per_view_launch = std::atoi(argv[++i]);
+        }else if(arg == "-encode-threads"){
+            args.encode_threads = std::atoi(argv[++i]);
+        }else if(arg == "-encode-queue"){
+            args.encode_queue = std::atoi(argv[++i]);
+        }else if(arg == "-dataset"){
+            args.dataset = argv[++i];
+        }else if(arg == "-dataset-shard-mb"){
+            args.dataset_shard_mb = std::atoi(argv[++i]);
+        }else if(arg == "-dataset-rgb"){
+            args.dataset_rgb = true;
+        }else if(arg == "-threads"){
+            args.threads = std::atoi(argv[++i]);
+        }else if(arg == "-stats-mem"){
+            args.stats_mem = std::atoi(argv[++i]);
+        }else if(arg == "-range"){
+            args.has_range = true;
+            args.range.x = std::atof(argv[++i]);
+            args.range.y = std::atof(argv[++i]);
+        }else if(arg == "-range-percentile"){
+            args.has_range_percentile = true;
+            args.range_percentile.x = std::atof(argv[++i]);
+            args.range_percentile.y = std::atof(argv[++i]);
+        }else if(arg == "-cameras"){
+            args.camera_file = argv[++i];
+        }else if(arg == "-shard"){
+            args.shard = parse_job_shard(argv[++i]);
+        }else if(arg == "-journal"){
+            args.journal = argv[++i];
+        }else if(arg == "-trace"){
+            args.trace = argv[++i];
+        }else if(arg == "-resume"){
+            args.resume = true;
+        }else if(arg == "-camera-order"){
+            args.camera_order = true;
+        }else if(arg == "-verbose"){
+            args.verbose = true;
         }else if(arg == "-multi-ts"){
             for(; i + 1 < argc; ++i){
                 if(argv[i+1][0] == '-'){
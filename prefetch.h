@@ -0,0 +1,133 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "load_raw.h"
+
+// Loads the timesteps of a series on a background thread, so the next
+// volumes are read from disk while the current one renders. At most `depth`
+// volumes are kept queued, and no more than `memory_budget` bytes of them
+// (0 means unlimited); a single volume is always allowed so a budget smaller
+// than one timestep still makes progress.
+class TimestepPrefetcher
+{
+ public:
+  TimestepPrefetcher(const std::vector<timesteps> &files,
+                     const vec3i &dims,
+                     const std::string &voxel_type,
+                     const bool use_mmap,
+                     const size_t depth,
+                     const size_t memory_budget);
+  ~TimestepPrefetcher();
+
+  TimestepPrefetcher(const TimestepPrefetcher &) = delete;
+  TimestepPrefetcher &operator=(const TimestepPrefetcher &) = delete;
+
+  // Blocks until the next timestep is loaded, returns false after the last
+  // one. Errors raised by the loader are rethrown here.
+  bool next(timesteps &file, Volume &volume);
+
+ private:
+  void run();
+
+  std::vector<timesteps> files;
+  vec3i dims;
+  std::string voxel_type;
+  bool use_mmap;
+  size_t depth;
+  size_t memory_budget;
+  size_t volume_bytes;
+
+  std::mutex mutex;
+  std::condition_variable cond;
+  std::deque<std::pair<timesteps, Volume>> ready;
+  size_t loaded = 0;
+  bool stop = false;
+  std::exception_ptr error = nullptr;
+
+  std::thread loader;
+};
+
+TimestepPrefetcher::TimestepPrefetcher(const std::vector<timesteps> &files,
+                                       const vec3i &dims,
+                                       const std::string &voxel_type,
+                                       const bool use_mmap,
+                                       const size_t depth,
+                                       const size_t memory_budget)
+    : files(files),
+      dims(dims),
+      voxel_type(voxel_type),
+      use_mmap(use_mmap),
+      depth(std::max(depth, size_t(1))),
+      memory_budget(memory_budget),
+      volume_bytes(size_t(dims.x) * size_t(dims.y) * size_t(dims.z)
+                   * voxel_size(parse_voxel_type(voxel_type)))
+{
+  loader = std::thread([this]() { run(); });
+}
+
+TimestepPrefetcher::~TimestepPrefetcher()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stop = true;
+  }
+  cond.notify_all();
+  loader.join();
+}
+
+bool TimestepPrefetcher::next(timesteps &file, Volume &volume)
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  cond.wait(lock, [&]() {
+    return !ready.empty() || error || loaded == files.size();
+  });
+  if (ready.empty()) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+    return false;
+  }
+  file = ready.front().first;
+  volume = ready.front().second;
+  ready.pop_front();
+  lock.unlock();
+  cond.notify_all();
+  return true;
+}
+
+void TimestepPrefetcher::run()
+{
+  for (const auto &f : files) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      cond.wait(lock, [&]() {
+        const bool in_budget = memory_budget == 0
+            || (ready.size() + 1) * volume_bytes <= memory_budget;
+        return stop || ready.empty() || (ready.size() < depth && in_budget);
+      });
+      if (stop) {
+        return;
+      }
+    }
+
+    try {
+      Volume volume = load_raw_volume(f.fileDir, dims, voxel_type, use_mmap);
+      std::lock_guard<std::mutex> lock(mutex);
+      ready.emplace_back(f, volume);
+      ++loaded;
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex);
+      error = std::current_exception();
+      cond.notify_all();
+      return;
+    }
+    cond.notify_all();
+  }
+}
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+// Append-only log of the (timestep, camera) jobs whose output has been
+// written, so an interrupted run can be resumed without rendering them again
+// or checking every output file.
+//
+// The file is a ProgressJournalHeader followed by one ProgressRecord per
+// finished job. Records are buffered and written with one write() and
+// fdatasync() per batch, once sync_jobs records are pending or sync_seconds
+// have passed, so a crash loses at most one batch. Before a batch is written
+// the filesystem of output_dir is synced once with syncfs(), which flushes
+// the output of its jobs along with the directory entries, so a journaled job
+// has its output on disk without one sync per output file. A failed write is
+// only reported and retried with the next batch, jobs missing from the
+// journal are merely rendered again. A record torn by a crash is dropped on
+// resume.
+struct ProgressJournalHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t record_size;
+};
+
+struct ProgressRecord
+{
+  int32_t timestep;
+  int32_t camera;
+};
+
+const char PROGRESS_JOURNAL_MAGIC[8] = {'O', 'S', 'P', 'J', 'R', 'N', 'L', '\0'};
+const uint32_t PROGRESS_JOURNAL_VERSION = 1;
+
+class ProgressJournal
+{
+ public:
+  // Starts a new journal, or with resume continues an existing one and
+  // loads the jobs it records as done. output_dir is where the jobs write
+  // their output.
+  ProgressJournal(const std::string &filename,
+                  const bool resume,
+                  const std::string &output_dir = ".",
+                  const size_t sync_jobs = 256,
+                  const double sync_seconds = 2.0);
+  ~ProgressJournal();
+
+  ProgressJournal(const ProgressJournal &) = delete;
+  ProgressJournal &operator=(const ProgressJournal &) = delete;
+
+  // whether a previous run finished the job, not updated by record()
+  bool done(const int timestep, const int camera) const;
+  // number of jobs finished by previous runs
+  size_t resumed() const;
+
+  // marks a job as finished, safe to call from any thread
+  void record(const int timestep, const int camera);
+  // writes out all recorded jobs
+  void sync();
+
+ private:
+  static uint64_t key(const int timestep, const int camera);
+  void syncLocked();
+
+  std::string filename;
+  size_t sync_jobs;
+  double sync_seconds;
+  int fd = -1;
+  // directory of the jobs' output, its filesystem is synced per batch
+  int output_fd = -1;
+  // end of the complete records, the next batch is written here
+  off_t end = 0;
+
+  std::unordered_set<uint64_t> finished;
+
+  std::mutex mutex;
+  std::vector<ProgressRecord> pending;
+  std::chrono::steady_clock::time_point last_sync;
+};
+
+ProgressJournal::ProgressJournal(const std::string &filename,
+                                 const bool resume,
+                                 const std::string &output_dir,
+                                 const size_t sync_jobs,
+                                 const double sync_seconds)
+    : filename(filename),
+      sync_jobs(std::max(sync_jobs, size_t(1))),
+      sync_seconds(sync_seconds),
+      last_sync(std::chrono::steady_clock::now())
+{
+  ProgressJournalHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, PROGRESS_JOURNAL_MAGIC, sizeof(header.magic));
+  header.version = PROGRESS_JOURNAL_VERSION;
+  header.record_size = sizeof(ProgressRecord);
+
+  if (resume) {
+    fd = open(filename.c_str(), O_RDWR);
+  }
+  if (fd >= 0) {
+    ProgressJournalHeader existing;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || pread(fd, &existing, sizeof(existing), 0) != sizeof(existing)
+        || std::memcmp(&existing, &header, sizeof(header)) != 0) {
+      close(fd);
+      throw std::runtime_error("Invalid progress journal " + filename);
+    }
+    const size_t n = (st.st_size - sizeof(header)) / sizeof(ProgressRecord);
+    std::vector<ProgressRecord> records(n);
+    if (n > 0 && pread(fd, records.data(), n * sizeof(ProgressRecord), sizeof(header))
+                     != ssize_t(n * sizeof(ProgressRecord))) {
+      close(fd);
+      throw std::runtime_error("Failed to read progress journal " + filename);
+    }
+    for (const auto &r : records) {
+      finished.insert(key(r.timestep, r.camera));
+    }
+    // a torn record is overwritten by the next batch
+    end = sizeof(header) + n * sizeof(ProgressRecord);
+  } else {
+    fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || ::write(fd, &header, sizeof(header)) != sizeof(header) || fdatasync(fd) != 0) {
+      throw std::runtime_error("Failed to create progress journal " + filename);
+    }
+    end = sizeof(header);
+  }
+
+  output_fd = open(output_dir.c_str(), O_RDONLY | O_DIRECTORY);
+  if (output_fd < 0) {
+    close(fd);
+    throw std::runtime_error("Failed to open output directory " + output_dir);
+  }
+}
+
+ProgressJournal::~ProgressJournal()
+{
+  sync();
+  close(output_fd);
+  close(fd);
+}
+
+uint64_t ProgressJournal::key(const int timestep, const int camera)
+{
+  return (uint64_t(uint32_t(timestep)) << 32) | uint32_t(camera);
+}
+
+bool ProgressJournal::done(const int timestep, const int camera) const
+{
+  return finished.count(key(timestep, camera)) > 0;
+}
+
+size_t ProgressJournal::resumed() const
+{
+  return finished.size();
+}
+
+void ProgressJournal::record(const int timestep, const int camera)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  pending.push_back(ProgressRecord{timestep, camera});
+  const double elapsed = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - last_sync).count();
+  if (pending.size() >= sync_jobs || elapsed >= sync_seconds) {
+    syncLocked();
+  }
+}
+
+void ProgressJournal::sync()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  syncLocked();
+}
+
+void ProgressJournal::syncLocked()
+{
+  last_sync = std::chrono::steady_clock::now();
+  if (pending.empty()) {
+    return;
+  }
+  const size_t bytes = pending.size() * sizeof(ProgressRecord);
+  if (syncfs(output_fd) != 0 || pwrite(fd, pending.data(), bytes, end) != ssize_t(bytes)
+      || fdatasync(fd) != 0) {
+    std::cerr << "Failed to append to progress journal " << filename << std::endl;
+    return;
+  }
+  end += bytes;
+  pending.clear();
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <dirent.h>
+#include <exception>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "load_raw.h"
+#include "parseArgs.h"
+
+// The timestep files in the -multi-ts directories sorted by timestep, the
+// timestep is parsed from the file name (skipping the stats caches)
+std::vector<timesteps> scan_timestep_files(const std::vector<std::string> &dirs)
+{
+    std::vector<timesteps> files;
+    for (const auto &dir : dirs) {
+        DIR *dp = opendir(dir.c_str());
+        if (!dp) {
+            throw std::runtime_error("failed to open directory: " + dir);
+        }
+        for (dirent *e = readdir(dp); e; e = readdir(dp)) {
+            const std::string name = e->d_name;
+            if (name.length() > 3 && !is_stats_cache_file(name)) {
+                const int timestep = std::stoi(name.substr(10, name.find(".") - 10));
+                files.push_back(timesteps(timestep, dir + "/" + name));
+            }
+        }
+        closedir(dp);
+    }
+    std::sort(files.begin(), files.end(), sort_timestep());
+    return files;
+}
+
+// Loader threads used when none are requested. The reduction of each volume
+// is itself threaded, extra loaders only overlap reads.
+const int SERIES_STATS_LOADERS = 4;
+
+// Statistics of every timestep of a series, gathered by a pool of n_threads
+// loader threads (0 means SERIES_STATS_LOADERS). Timesteps with a valid stats
+// cache are not read; the others are loaded, reduced and dropped one at a
+// time, so at most one volume per thread is resident. With a memory_budget
+// (bytes, 0 means unlimited) the pool is shrunk so that those volumes fit in
+// it; one loader always runs.
+std::vector<VolumeStats> load_series_stats(const std::vector<timesteps> &files,
+                                           const vec3i &dims,
+                                           const std::string &voxel_type,
+                                           const bool use_mmap,
+                                           const int n_threads,
+                                           const size_t memory_budget = 0)
+{
+    std::vector<VolumeStats> stats(files.size());
+    std::vector<size_t> uncached;
+    for (size_t i = 0; i < files.size(); ++i) {
+        if (!read_stats_cache(files[i].fileDir, dims, voxel_type, stats[i])) {
+            uncached.push_back(i);
+        }
+    }
+    if (uncached.empty()) {
+        return stats;
+    }
+    // a cold cache costs a full read of the series before anything else runs
+    std::cout << "reading " << uncached.size() << " of " << files.size()
+              << " timesteps without a stats cache to compute their statistics" << std::endl;
+
+    int n_loaders = n_threads > 0 ? n_threads : SERIES_STATS_LOADERS;
+    if (memory_budget > 0) {
+        const size_t volume_bytes = size_t(dims.x) * size_t(dims.y) * size_t(dims.z)
+            * voxel_size(parse_voxel_type(voxel_type));
+        n_loaders = int(std::min(size_t(n_loaders), std::max(memory_budget / volume_bytes, size_t(1))));
+    }
+    n_loaders = int(std::min(size_t(n_loaders), uncached.size()));
+
+    std::atomic<size_t> next_file(0);
+    std::mutex error_mutex;
+    std::exception_ptr error = nullptr;
+
+    std::vector<std::thread> loaders;
+    for (int t = 0; t < n_loaders; ++t) {
+        loaders.emplace_back([&]() {
+            try {
+                for (size_t n = next_file++; n < uncached.size(); n = next_file++) {
+                    const size_t i = uncached[n];
+                    stats[i] = load_raw_volume(files[i].fileDir, dims, voxel_type, use_mmap).stats;
+                }
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                error = std::current_exception();
+            }
+        });
+    }
+    for (auto &l : loaders) {
+        l.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    return stats;
+}
+
+vec2f global_range(const std::vector<VolumeStats> &stats)
+{
+    vec2f range(std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity());
+    for (const auto &s : stats) {
+        range.x = std::min(range.x, s.range.x);
+        range.y = std::max(range.y, s.range.y);
+    }
+    return range;
+}
+
+// Transfer function range of a series: the percentiles lo..hi (0-100) of the
+// merged value distribution with -range-percentile, the full range otherwise
+vec2f series_range(const std::vector<VolumeStats> &stats, const Args &args)
+{
+    if (args.has_range_percentile) {
+        return percentile_range(merge_volume_stats(stats),
+                                args.range_percentile.x,
+                                args.range_percentile.y);
+    }
+    return global_range(stats);
+}
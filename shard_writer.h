@@ -0,0 +1,366 @@
+#pragma once
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "rkcommon/math/vec.h"
+
+using namespace rkcommon::math;
+
+// Rendered frames packed into large shard files for training pipelines,
+// instead of one small image file per view.
+//
+// <prefix>_00000.bin, <prefix>_00001.bin, ... hold raw uint8 frames back to
+// back (RGBA, or RGB with the alpha dropped), a shard is closed once it
+// exceeds the size limit. Every frame has the same size, so a shard can be
+// mapped and indexed as an array of frames.
+//
+// <prefix>.idx starts with a ShardIndexHeader followed by one ShardRecord per
+// frame, locating it by (timestep, camera, transfer function) and storing the
+// camera it was rendered with.
+//
+// Frames and records go through large stdio buffers, so writing is a
+// sequential append with few system calls.
+struct ShardIndexHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t width;
+  uint32_t height;
+  uint32_t channels;
+  uint32_t record_size;
+  uint32_t reserved;
+};
+
+struct ShardRecord
+{
+  int32_t timestep;
+  int32_t camera;
+  int32_t tf;
+  uint32_t shard;
+  uint64_t offset;
+  float pos[3];
+  float dir[3];
+  float up[3];
+  float fovy;
+};
+
+const char SHARD_INDEX_MAGIC[8] = {'O', 'S', 'P', 'S', 'H', 'R', 'D', '\0'};
+const uint32_t SHARD_INDEX_VERSION = 1;
+
+// <prefix>_<id>.bin
+inline std::string shard_file_name(const std::string &prefix, const uint32_t id)
+{
+  char suffix[16];
+  std::snprintf(suffix, sizeof(suffix), "_%05u.bin", id);
+  return prefix + suffix;
+}
+
+class ShardWriter
+{
+ public:
+  ShardWriter(const std::string &prefix,
+              const vec2i &size,
+              const int channels,
+              const size_t max_shard_bytes);
+  ~ShardWriter();
+
+  ShardWriter(const ShardWriter &) = delete;
+  ShardWriter &operator=(const ShardWriter &) = delete;
+
+  // rgba holds size.x * size.y RGBA8 pixels as mapped from the framebuffer
+  void append(const uint32_t *rgba,
+              const int timestep,
+              const int camera,
+              const int tf,
+              const vec3f &pos,
+              const vec3f &dir,
+              const vec3f &up,
+              const float fovy);
+
+  // flushes the last shard and the index to disk and closes them, throws if
+  // that fails. The destructor only closes what is still open without
+  // checking, so a finished dataset must be closed explicitly.
+  void close();
+
+ private:
+  void openShard();
+  // flushes, syncs and closes a file, throws naming the file on failure
+  static void closeFile(FILE *&file, const std::string &name);
+
+  std::string prefix;
+  vec2i size;
+  int channels;
+  size_t frame_bytes;
+  size_t max_shard_bytes;
+
+  FILE *index = nullptr;
+  FILE *shard = nullptr;
+  uint32_t shard_id = 0;
+  uint64_t shard_bytes = 0;
+  std::vector<uint8_t> frame;
+  std::vector<char> index_buffer;
+  std::vector<char> shard_buffer;
+};
+
+ShardWriter::ShardWriter(const std::string &prefix,
+                         const vec2i &size,
+                         const int channels,
+                         const size_t max_shard_bytes)
+    : prefix(prefix),
+      size(size),
+      channels(channels),
+      frame_bytes(size_t(size.x) * size_t(size.y) * channels),
+      max_shard_bytes(max_shard_bytes),
+      frame(frame_bytes),
+      index_buffer(1 << 20),
+      shard_buffer(16 << 20)
+{
+  if (channels != 3 && channels != 4) {
+    throw std::runtime_error("Shard frames must have 3 or 4 channels");
+  }
+
+  const std::string index_name = prefix + ".idx";
+  index = std::fopen(index_name.c_str(), "wb");
+  if (!index) {
+    throw std::runtime_error("Failed to create shard index " + index_name);
+  }
+  std::setvbuf(index, index_buffer.data(), _IOFBF, index_buffer.size());
+
+  ShardIndexHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, SHARD_INDEX_MAGIC, sizeof(header.magic));
+  header.version = SHARD_INDEX_VERSION;
+  header.width = size.x;
+  header.height = size.y;
+  header.channels = channels;
+  header.record_size = sizeof(ShardRecord);
+  if (std::fwrite(&header, sizeof(header), 1, index) != 1) {
+    std::fclose(index);
+    throw std::runtime_error("Failed to write shard index " + index_name);
+  }
+
+  openShard();
+}
+
+ShardWriter::~ShardWriter()
+{
+  if (shard) {
+    std::fclose(shard);
+  }
+  if (index) {
+    std::fclose(index);
+  }
+}
+
+void ShardWriter::close()
+{
+  closeFile(shard, shard_file_name(prefix, shard_id));
+  closeFile(index, prefix + ".idx");
+}
+
+void ShardWriter::closeFile(FILE *&file, const std::string &name)
+{
+  if (!file) {
+    return;
+  }
+  const bool ok = std::fflush(file) == 0 && fdatasync(fileno(file)) == 0;
+  const bool closed = std::fclose(file) == 0;
+  file = nullptr;
+  if (!ok || !closed) {
+    throw std::runtime_error("Failed to write " + name);
+  }
+}
+
+void ShardWriter::openShard()
+{
+  if (shard) {
+    closeFile(shard, shard_file_name(prefix, shard_id));
+    ++shard_id;
+  }
+  const std::string name = shard_file_name(prefix, shard_id);
+  shard = std::fopen(name.c_str(), "wb");
+  if (!shard) {
+    throw std::runtime_error("Failed to create shard " + name);
+  }
+  std::setvbuf(shard, shard_buffer.data(), _IOFBF, shard_buffer.size());
+  shard_bytes = 0;
+}
+
+void ShardWriter::append(const uint32_t *rgba,
+                         const int timestep,
+                         const int camera,
+                         const int tf,
+                         const vec3f &pos,
+                         const vec3f &dir,
+                         const vec3f &up,
+                         const float fovy)
+{
+  if (shard_bytes > 0 && shard_bytes + frame_bytes > max_shard_bytes) {
+    openShard();
+  }
+
+  const uint8_t *src = reinterpret_cast<const uint8_t *>(rgba);
+  const uint8_t *pixels = src;
+  if (channels == 3) {
+    const size_t n_pixels = size_t(size.x) * size_t(size.y);
+    for (size_t i = 0; i < n_pixels; ++i) {
+      std::memcpy(&frame[i * 3], src + i * 4, 3);
+    }
+    pixels = frame.data();
+  }
+
+  ShardRecord record;
+  record.timestep = timestep;
+  record.camera = camera;
+  record.tf = tf;
+  record.shard = shard_id;
+  record.offset = shard_bytes;
+  for (int i = 0; i < 3; ++i) {
+    record.pos[i] = pos[i];
+    record.dir[i] = dir[i];
+    record.up[i] = up[i];
+  }
+  record.fovy = fovy;
+
+  if (std::fwrite(pixels, 1, frame_bytes, shard) != frame_bytes
+      || std::fwrite(&record, sizeof(record), 1, index) != 1) {
+    throw std::runtime_error("Failed to append to shards " + prefix);
+  }
+  shard_bytes += frame_bytes;
+}
+
+// Opens a part index for reading past its header, throws if it is not one
+inline FILE *open_part_index(const std::string &part_index, ShardIndexHeader &header)
+{
+  FILE *in = std::fopen(part_index.c_str(), "rb");
+  if (!in || std::fread(&header, sizeof(header), 1, in) != 1
+      || std::memcmp(header.magic, SHARD_INDEX_MAGIC, sizeof(header.magic)) != 0
+      || header.version != SHARD_INDEX_VERSION
+      || header.record_size != sizeof(ShardRecord)) {
+    if (in) {
+      std::fclose(in);
+    }
+    throw std::runtime_error("Invalid shard index " + part_index);
+  }
+  return in;
+}
+
+inline bool file_exists(const std::string &name)
+{
+  FILE *f = std::fopen(name.c_str(), "rb");
+  if (f) {
+    std::fclose(f);
+  }
+  return f != nullptr;
+}
+
+// Combines the datasets written under the prefixes in `parts` into a single
+// dataset under `prefix`: the shard files are renamed into one sequence and
+// the indices are concatenated in the order of `parts`, with the shard
+// numbers of their records shifted to match. All parts must have the same
+// frame layout.
+//
+// Every part is validated before anything is moved, and the merged index is
+// written to a temporary file first. The part indices are only removed once
+// the merged index is in place, so a merge that fails partway can simply be
+// run again: shards that were already renamed are recognized by their merged
+// name.
+void merge_shard_datasets(const std::string &prefix, const std::vector<std::string> &parts)
+{
+  std::vector<ShardRecord> records(1 << 14);
+
+  // validate the parts and number their shards, every part opens its first
+  // shard up front so it has at least one
+  ShardIndexHeader merged;
+  std::vector<uint32_t> first_shard(parts.size() + 1, 0);
+  for (size_t p = 0; p < parts.size(); ++p) {
+    const std::string part_index = parts[p] + ".idx";
+    ShardIndexHeader header;
+    FILE *in = open_part_index(part_index, header);
+    if (p == 0) {
+      merged = header;
+    } else if (header.width != merged.width || header.height != merged.height
+               || header.channels != merged.channels) {
+      std::fclose(in);
+      throw std::runtime_error("Shard index " + part_index + " has a different frame layout");
+    }
+    uint32_t part_shards = 1;
+    size_t n = 0;
+    while ((n = std::fread(records.data(), sizeof(ShardRecord), records.size(), in)) > 0) {
+      for (size_t i = 0; i < n; ++i) {
+        part_shards = std::max(part_shards, records[i].shard + 1);
+      }
+    }
+    const bool ok = !std::ferror(in);
+    std::fclose(in);
+    if (!ok) {
+      throw std::runtime_error("Failed to read shard index " + part_index);
+    }
+    first_shard[p + 1] = first_shard[p] + part_shards;
+    for (uint32_t s = 0; s < part_shards; ++s) {
+      if (!file_exists(shard_file_name(parts[p], s))
+          && !file_exists(shard_file_name(prefix, first_shard[p] + s))) {
+        throw std::runtime_error("Missing shard " + shard_file_name(parts[p], s));
+      }
+    }
+  }
+  if (parts.empty()) {
+    return;
+  }
+
+  // the merged index, complete before any shard is renamed
+  const std::string index_name = prefix + ".idx";
+  const std::string tmp_name = index_name + ".tmp";
+  FILE *out = std::fopen(tmp_name.c_str(), "wb");
+  if (!out) {
+    throw std::runtime_error("Failed to create shard index " + tmp_name);
+  }
+  bool ok = std::fwrite(&merged, sizeof(merged), 1, out) == 1;
+  for (size_t p = 0; ok && p < parts.size(); ++p) {
+    ShardIndexHeader header;
+    FILE *in = nullptr;
+    try {
+      in = open_part_index(parts[p] + ".idx", header);
+    } catch (...) {
+      std::fclose(out);
+      throw;
+    }
+    size_t n = 0;
+    while (ok && (n = std::fread(records.data(), sizeof(ShardRecord), records.size(), in)) > 0) {
+      for (size_t i = 0; i < n; ++i) {
+        records[i].shard += first_shard[p];
+      }
+      ok = std::fwrite(records.data(), sizeof(ShardRecord), n, out) == n;
+    }
+    ok = ok && !std::ferror(in);
+    std::fclose(in);
+  }
+  if (std::fclose(out) != 0 || !ok) {
+    std::remove(tmp_name.c_str());
+    throw std::runtime_error("Failed to write shard index " + tmp_name);
+  }
+
+  for (size_t p = 0; p < parts.size(); ++p) {
+    for (uint32_t s = 0; s < first_shard[p + 1] - first_shard[p]; ++s) {
+      const std::string name = shard_file_name(parts[p], s);
+      const std::string merged_name = shard_file_name(prefix, first_shard[p] + s);
+      if (file_exists(name) && std::rename(name.c_str(), merged_name.c_str()) != 0) {
+        throw std::runtime_error("Failed to rename " + name + " to " + merged_name);
+      }
+    }
+  }
+  if (std::rename(tmp_name.c_str(), index_name.c_str()) != 0) {
+    throw std::runtime_error("Failed to write shard index " + index_name);
+  }
+  for (const auto &part : parts) {
+    std::remove((part + ".idx").c_str());
+  }
+}
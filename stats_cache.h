@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "volume_stats.h"
+
+// Statistics of a raw volume file are cached next to it in <file>.stats, so
+// the range and histogram of a series can be gathered without reading the
+// voxels again. An entry is only used while the size and modification time
+// of the raw file, and the dims and voxel type it is read with, still match.
+//
+// Layout: StatsCacheHeader, then the histogram_bins non-empty HistogramBins.
+struct StatsCacheHeader
+{
+  char magic[8];
+  uint64_t file_size;
+  int64_t mtime_sec;
+  int64_t mtime_nsec;
+  int32_t dims[3];
+  char voxel_type[16];
+  float range[2];
+  double mean;
+  uint32_t histogram_bins;
+};
+
+const char STATS_CACHE_MAGIC[8] = {'O', 'S', 'P', 'S', 'T', 'A', 'T', '2'};
+
+std::string stats_cache_name(const std::string &fname)
+{
+  return fname + ".stats";
+}
+
+// Cache files live in the data directories, directory scans skip them
+bool is_stats_cache_file(const std::string &name)
+{
+  const std::string suffix = ".stats";
+  return name.find(suffix + ".tmp") != std::string::npos
+      || (name.size() >= suffix.size()
+          && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0);
+}
+
+// Header identifying the current version of fname, false if it can't be stat'ed
+bool stats_cache_key(const std::string &fname,
+                     const vec3i &dims,
+                     const std::string &voxel_type,
+                     StatsCacheHeader &header)
+{
+  struct stat st;
+  if (stat(fname.c_str(), &st) != 0) {
+    return false;
+  }
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, STATS_CACHE_MAGIC, sizeof(header.magic));
+  header.file_size = uint64_t(st.st_size);
+  header.mtime_sec = int64_t(st.st_mtim.tv_sec);
+  header.mtime_nsec = int64_t(st.st_mtim.tv_nsec);
+  header.dims[0] = dims.x;
+  header.dims[1] = dims.y;
+  header.dims[2] = dims.z;
+  std::strncpy(header.voxel_type, voxel_type.c_str(), sizeof(header.voxel_type) - 1);
+  return true;
+}
+
+bool read_stats_cache(const std::string &fname,
+                      const vec3i &dims,
+                      const std::string &voxel_type,
+                      VolumeStats &stats)
+{
+  StatsCacheHeader key;
+  if (!stats_cache_key(fname, dims, voxel_type, key)) {
+    return false;
+  }
+  FILE *fin = std::fopen(stats_cache_name(fname).c_str(), "rb");
+  if (!fin) {
+    return false;
+  }
+
+  StatsCacheHeader header;
+  bool valid = std::fread(&header, sizeof(header), 1, fin) == 1
+      && std::memcmp(header.magic, key.magic, sizeof(key.magic)) == 0
+      && header.file_size == key.file_size && header.mtime_sec == key.mtime_sec
+      && header.mtime_nsec == key.mtime_nsec
+      && std::memcmp(header.dims, key.dims, sizeof(key.dims)) == 0
+      && std::strncmp(header.voxel_type, key.voxel_type, sizeof(key.voxel_type)) == 0
+      && header.histogram_bins <= uint32_t(VOLUME_HISTOGRAM_BINS);
+  if (valid) {
+    stats.range = vec2f(header.range[0], header.range[1]);
+    stats.mean = header.mean;
+    stats.histogram.resize(header.histogram_bins);
+    valid = std::fread(stats.histogram.data(), sizeof(HistogramBin), header.histogram_bins, fin)
+        == header.histogram_bins;
+  }
+  std::fclose(fin);
+  return valid;
+}
+
+// Failing to write the cache (e.g. on a read-only file system) only costs the
+// next run a re-read, so it is reported but not an error. The cache is written
+// to a temporary file and renamed, so concurrent readers never see half of it.
+void write_stats_cache(const std::string &fname,
+                       const vec3i &dims,
+                       const std::string &voxel_type,
+                       const VolumeStats &stats)
+{
+  StatsCacheHeader header;
+  if (!stats_cache_key(fname, dims, voxel_type, header)) {
+    return;
+  }
+  header.range[0] = stats.range.x;
+  header.range[1] = stats.range.y;
+  header.mean = stats.mean;
+  header.histogram_bins = uint32_t(stats.histogram.size());
+
+  const std::string name = stats_cache_name(fname);
+  const std::string tmp_name = name + ".tmp" + std::to_string(getpid());
+  FILE *fout = std::fopen(tmp_name.c_str(), "wb");
+  if (!fout) {
+    std::cerr << "Cannot write stats cache " << name << std::endl;
+    return;
+  }
+  const bool ok = std::fwrite(&header, sizeof(header), 1, fout) == 1
+      && std::fwrite(stats.histogram.data(), sizeof(HistogramBin), stats.histogram.size(), fout)
+          == stats.histogram.size();
+  if (std::fclose(fout) != 0 || !ok || std::rename(tmp_name.c_str(), name.c_str()) != 0) {
+    std::cerr << "Cannot write stats cache " << name << std::endl;
+    std::remove(tmp_name.c_str());
+  }
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#include "rkcommon/math/vec.h"
+#include "rkcommon/tasking/parallel_for.h"
+#include "load_raw.h"
+
+using namespace rkcommon::math;
+
+// Analytic test volumes, so tools and benchmarks can run without simulation
+// data. Every field is a deterministic function of the normalized position
+// p in [-1, 1]^3 with values in [0, 1]:
+//
+//   marschner-lobb  the Marschner-Lobb test signal (f_M = 6, alpha = 0.25)
+//   noise           4 octaves of trilinear value noise
+//   gradient        a linear ramp along the diagonal
+//   sphere          distance from the center
+//
+// Values are quantized to the full range of integer voxel types.
+inline float marschner_lobb(const vec3f &p)
+{
+    const float f_m = 6.f;
+    const float alpha = 0.25f;
+    const float r = std::sqrt(p.x * p.x + p.y * p.y);
+    const float rho = std::cos(2.f * float(M_PI) * f_m * std::cos(float(M_PI) * r / 2.f));
+    return (1.f - std::sin(float(M_PI) * p.z / 2.f) + alpha * (1.f + rho)) / (2.f * (1.f + alpha));
+}
+
+inline float lattice_value(const int x, const int y, const int z, const int octave)
+{
+    uint32_t h = uint32_t(x) * 0x8da6b343u ^ uint32_t(y) * 0xd8163841u
+        ^ uint32_t(z) * 0xcb1ab31fu ^ uint32_t(octave) * 0x165667b1u;
+    h ^= h >> 15;
+    h *= 0x2c1b3c6du;
+    h ^= h >> 12;
+    h *= 0x297a2d39u;
+    h ^= h >> 15;
+    return (h >> 8) * (1.f / 16777216.f);
+}
+
+inline float value_noise(const vec3f &p)
+{
+    float value = 0.f;
+    float amplitude = 0.5f;
+    float frequency = 4.f;
+    for (int octave = 0; octave < 4; ++octave) {
+        const vec3f q((p.x + 1.f) * frequency, (p.y + 1.f) * frequency, (p.z + 1.f) * frequency);
+        const int x = int(std::floor(q.x)), y = int(std::floor(q.y)), z = int(std::floor(q.z));
+        const float fx = q.x - x, fy = q.y - y, fz = q.z - z;
+        float c[2][2][2];
+        for (int k = 0; k < 2; ++k)
+            for (int j = 0; j < 2; ++j)
+                for (int i = 0; i < 2; ++i)
+                    c[k][j][i] = lattice_value(x + i, y + j, z + k, octave);
+        const float c00 = c[0][0][0] + fx * (c[0][0][1] - c[0][0][0]);
+        const float c01 = c[0][1][0] + fx * (c[0][1][1] - c[0][1][0]);
+        const float c10 = c[1][0][0] + fx * (c[1][0][1] - c[1][0][0]);
+        const float c11 = c[1][1][0] + fx * (c[1][1][1] - c[1][1][0]);
+        const float c0 = c00 + fy * (c01 - c00);
+        const float c1 = c10 + fy * (c11 - c10);
+        value += amplitude * (c0 + fz * (c1 - c0));
+        amplitude *= 0.5f;
+        frequency *= 2.f;
+    }
+    // the octaves sum to at most 1 - 2^-4
+    return value / 0.9375f;
+}
+
+inline float synthetic_field(const std::string &field, const vec3f &p)
+{
+    if (field == "marschner-lobb") {
+        return marschner_lobb(p);
+    } else if (field == "noise") {
+        return value_noise(p);
+    } else if (field == "gradient") {
+        return (p.x + p.y + p.z + 3.f) / 6.f;
+    } else if (field == "sphere") {
+        return std::sqrt(p.x * p.x + p.y * p.y + p.z * p.z) / std::sqrt(3.f);
+    }
+    throw std::runtime_error("Unrecognized synthetic field " + field);
+}
+
+inline uint16_t float_to_half(const float f)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &f, sizeof(bits));
+    const uint16_t sign = (bits >> 16) & 0x8000;
+    const int exponent = int((bits >> 23) & 0xff) - 127 + 15;
+    uint32_t mantissa = bits & 0x7fffff;
+    if (exponent >= 31) {
+        return sign | 0x7c00;
+    }
+    if (exponent <= 0) {
+        if (exponent < -10) {
+            return sign;
+        }
+        // subnormal
+        mantissa = (mantissa | 0x800000) >> (1 - exponent);
+        return sign | uint16_t((mantissa + 0x1000) >> 13);
+    }
+    // round to nearest, a carry into the exponent is still correct
+    return sign | uint16_t(((exponent << 10) | (mantissa >> 13)) + ((mantissa >> 12) & 1));
+}
+
+template <typename T, typename Convert>
+void fill_synthetic(Volume &volume, const std::string &field, Convert &&convert)
+{
+    T *voxels = reinterpret_cast<T *>(volume.voxel_data->data());
+    const vec3i dims = volume.dims;
+    rkcommon::tasking::parallel_for(dims.z, [&](const int z) {
+        for (int y = 0; y < dims.y; ++y) {
+            for (int x = 0; x < dims.x; ++x) {
+                const vec3f p(2.f * (x + 0.5f) / dims.x - 1.f,
+                              2.f * (y + 0.5f) / dims.y - 1.f,
+                              2.f * (z + 0.5f) / dims.z - 1.f);
+                voxels[(size_t(z) * dims.y + y) * dims.x + x] = convert(synthetic_field(field, p));
+            }
+        }
+    });
+}
+
+Volume make_synthetic_volume(const std::string &field,
+                             const vec3i &dims,
+                             const std::string &voxel_type)
+{
+    Volume volume;
+    volume.dims = dims;
+    volume.voxel_type = parse_voxel_type(voxel_type);
+    volume.voxel_data = std::make_shared<std::vector<uint8_t>>(volume.n_bytes());
+    switch (volume.voxel_type) {
+    case VoxelType::UINT8:
+        fill_synthetic<uint8_t>(volume, field, [](const float v) { return uint8_t(v * 255.f + 0.5f); });
+        break;
+    case VoxelType::UINT16:
+        fill_synthetic<uint16_t>(volume, field, [](const float v) { return uint16_t(v * 65535.f + 0.5f); });
+        break;
+    case VoxelType::HALF:
+        fill_synthetic<uint16_t>(volume, field, [](const float v) { return float_to_half(v); });
+        break;
+    case VoxelType::FLOAT32:
+        fill_synthetic<float>(volume, field, [](const float v) { return v; });
+        break;
+    default:
+        fill_synthetic<double>(volume, field, [](const float v) { return double(v); });
+        break;
+    }
+    volume.stats = compute_stats(volume);
+    volume.range = volume.stats.range;
+    return volume;
+}
+
+// writes the voxels as a raw file that load_raw_volume() reads back
+void write_raw_volume(const std::string &fname, const Volume &volume)
+{
+    std::ofstream fout(fname.c_str(), std::ios::binary);
+    if (!fout.write(static_cast<const char *>(volume.data()), volume.n_bytes())) {
+        throw std::runtime_error("Failed to write volume " + fname);
+    }
+}
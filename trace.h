@@ -0,0 +1,219 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Timing of the phases of a run (loading, stats, scene build, frames, map,
+// encode, ...). Every phase keeps a log-scale histogram of its durations for
+// the end-of-run summary, so memory stays fixed however long the run is.
+// With enableTrace() the individual events are also streamed to a Chrome
+// trace-event JSON file (chrome://tracing, Perfetto) as they complete.
+//
+// Phases are timed with TraceScope, or with record() for work that is not a
+// scope on one thread, such as an asynchronous frame.
+class Tracer
+{
+ public:
+  using clock = std::chrono::steady_clock;
+
+  static Tracer &instance();
+  ~Tracer();
+
+  void enableTrace(const std::string &filename);
+  // Adds one event of phase. tid -1 is the calling thread, others name a
+  // separate timeline row such as a render slot.
+  void record(const char *phase,
+              const clock::time_point &start,
+              const clock::time_point &end,
+              const int tid = -1);
+  // an output image was finished, for the images/sec of the summary
+  void countImage();
+
+  // p50/p95/p99 per phase and the image rate since the tracer was created
+  void printSummary(std::ostream &os);
+  // flushes and closes the trace file
+  void finishTrace();
+
+ private:
+  struct Event
+  {
+    const char *phase;
+    int tid;
+    double start_us;
+    double duration_us;
+  };
+
+  // buckets of 1/16 octave from 1 us to 2^36 us (~19 hours)
+  static const int BUCKETS_PER_OCTAVE = 16;
+  static const int OCTAVES = 36;
+  struct PhaseStats
+  {
+    size_t count = 0;
+    double total_us = 0.0;
+    double max_us = 0.0;
+    std::vector<uint64_t> histogram =
+        std::vector<uint64_t>(BUCKETS_PER_OCTAVE * OCTAVES + 1, 0);
+  };
+
+  Tracer();
+  static int threadId();
+  double percentile(const PhaseStats &stats, const double p) const;
+  void flushLocked();
+
+  clock::time_point epoch;
+  std::atomic<size_t> images{0};
+
+  std::mutex mutex;
+  std::map<std::string, PhaseStats> phases;
+  FILE *trace = nullptr;
+  bool first_event = true;
+  std::vector<Event> events;
+};
+
+// Times the enclosing scope as one event of phase, phase must be a literal
+class TraceScope
+{
+ public:
+  explicit TraceScope(const char *phase) : phase(phase), start(Tracer::clock::now()) {}
+  ~TraceScope()
+  {
+    Tracer::instance().record(phase, start, Tracer::clock::now());
+  }
+
+  TraceScope(const TraceScope &) = delete;
+  TraceScope &operator=(const TraceScope &) = delete;
+
+ private:
+  const char *phase;
+  Tracer::clock::time_point start;
+};
+
+Tracer &Tracer::instance()
+{
+  static Tracer tracer;
+  return tracer;
+}
+
+Tracer::Tracer() : epoch(clock::now()) {}
+
+Tracer::~Tracer()
+{
+  finishTrace();
+}
+
+int Tracer::threadId()
+{
+  static std::atomic<int> next_id{0};
+  thread_local int id = next_id++;
+  return id;
+}
+
+void Tracer::enableTrace(const std::string &filename)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  trace = std::fopen(filename.c_str(), "w");
+  if (!trace) {
+    std::cerr << "Failed to create trace file " << filename << std::endl;
+    return;
+  }
+  std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", trace);
+  first_event = true;
+  events.reserve(1 << 16);
+}
+
+void Tracer::record(const char *phase,
+                    const clock::time_point &start,
+                    const clock::time_point &end,
+                    const int tid)
+{
+  const double start_us = std::chrono::duration<double, std::micro>(start - epoch).count();
+  const double duration_us = std::chrono::duration<double, std::micro>(end - start).count();
+  const int bucket = duration_us < 1.0
+      ? 0
+      : std::min(int(std::log2(duration_us) * BUCKETS_PER_OCTAVE) + 1,
+                 BUCKETS_PER_OCTAVE * OCTAVES);
+  const int event_tid = tid < 0 ? threadId() : tid;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  PhaseStats &stats = phases[phase];
+  ++stats.count;
+  stats.total_us += duration_us;
+  stats.max_us = std::max(stats.max_us, duration_us);
+  ++stats.histogram[bucket];
+
+  if (trace) {
+    events.push_back(Event{phase, event_tid, start_us, duration_us});
+    if (events.size() == events.capacity()) {
+      flushLocked();
+    }
+  }
+}
+
+void Tracer::countImage()
+{
+  ++images;
+}
+
+void Tracer::flushLocked()
+{
+  for (const auto &e : events) {
+    std::fprintf(trace, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                 first_event ? "" : ",", e.phase, e.tid, e.start_us, e.duration_us);
+    first_event = false;
+  }
+  events.clear();
+}
+
+void Tracer::finishTrace()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!trace) {
+    return;
+  }
+  flushLocked();
+  std::fputs("\n]}\n", trace);
+  std::fclose(trace);
+  trace = nullptr;
+}
+
+double Tracer::percentile(const PhaseStats &stats, const double p) const
+{
+  const uint64_t target = uint64_t(std::ceil(p / 100.0 * stats.count));
+  uint64_t seen = 0;
+  for (size_t b = 0; b < stats.histogram.size(); ++b) {
+    seen += stats.histogram[b];
+    if (seen >= std::max(target, uint64_t(1))) {
+      // upper edge of the bucket, clamped to the largest duration seen
+      const double upper = b == 0 ? 1.0 : std::exp2(double(b) / BUCKETS_PER_OCTAVE);
+      return std::min(upper, stats.max_us);
+    }
+  }
+  return stats.max_us;
+}
+
+void Tracer::printSummary(std::ostream &os)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  const double seconds = std::chrono::duration<double>(clock::now() - epoch).count();
+  char line[160];
+  std::snprintf(line, sizeof(line), "%-20s %10s %12s %10s %10s %10s %10s\n",
+                "phase", "count", "total s", "mean ms", "p50 ms", "p95 ms", "p99 ms");
+  os << line;
+  for (const auto &p : phases) {
+    const PhaseStats &s = p.second;
+    std::snprintf(line, sizeof(line), "%-20s %10zu %12.3f %10.3f %10.3f %10.3f %10.3f\n",
+                  p.first.c_str(), s.count, s.total_us * 1e-6, s.total_us / s.count * 1e-3,
+                  percentile(s, 50) * 1e-3, percentile(s, 95) * 1e-3, percentile(s, 99) * 1e-3);
+    os << line;
+  }
+  os << images << " images in " << seconds << " s, "
+     << (seconds > 0.0 ? images / seconds : 0.0) << " images/s" << std::endl;
+}
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "ospray/ospray_cpp.h"
+
+#include "accumulate.h"
+#include "volume_scene.h"
+#include "trace.h"
+
+// trace timeline rows of the render slots
+const int TRACE_RENDER_SLOT_TID = 1000;
+// how often renderViews() polls the frames in flight when none is done,
+// also the resolution of their traced completion times
+const std::chrono::microseconds RENDER_POLL_INTERVAL(100);
+
+// Hands out the jobs [0, n_jobs) to n_workers. Every worker starts with its
+// own contiguous run of jobs, so it renders neighbouring views in order; a
+// worker whose run is empty steals the back half of the largest remaining
+// run. Runs are only touched by the thread driving the scheduler.
+class WorkStealingQueue
+{
+ public:
+  WorkStealingQueue(const size_t n_jobs, const int n_workers);
+
+  // the next job of worker, false once there is none left anywhere
+  bool next(const int worker, size_t &job);
+  size_t steals() const
+  {
+    return n_steals;
+  }
+
+ private:
+  struct Run
+  {
+    size_t begin = 0;
+    size_t end = 0;
+  };
+
+  std::vector<Run> runs;
+  size_t n_steals = 0;
+};
+
+WorkStealingQueue::WorkStealingQueue(const size_t n_jobs, const int n_workers)
+    : runs(std::max(n_workers, 1))
+{
+  for (size_t w = 0; w < runs.size(); ++w) {
+    runs[w].begin = n_jobs * w / runs.size();
+    runs[w].end = n_jobs * (w + 1) / runs.size();
+  }
+}
+
+bool WorkStealingQueue::next(const int worker, size_t &job)
+{
+  Run &own = runs[worker];
+  if (own.begin == own.end) {
+    auto victim = std::max_element(runs.begin(), runs.end(), [](const Run &a, const Run &b) {
+      return a.end - a.begin < b.end - b.begin;
+    });
+    const size_t remaining = victim->end - victim->begin;
+    if (remaining == 0) {
+      return false;
+    }
+    // leave the victim the front half it is about to render
+    const size_t split = victim->end - (remaining + 1) / 2;
+    own.begin = split;
+    own.end = victim->end;
+    victim->end = split;
+    ++n_steals;
+  }
+  job = own.begin++;
+  return true;
+}
+
+// Renders views [0, n_views) with all framebuffer/camera pairs of the scene
+// accumulating different views concurrently. Each frame is submitted
+// asynchronously; whenever one completes its slot either queues the next
+// frame of its view or, once the view has max_frames or converged by the same
+// test as accumulateFrames() (see view_converged()), hands it to
+// finish(slot, view, frames) and takes its next view from a
+// WorkStealingQueue. set_view(slot, view) sets up scene.cameras[slot].
+//
+// A single small image has too few tiles to keep all cores busy, several in
+// flight do. Each renderFrame() renders frames_per_launch frames of its one
+// view, with the renderer set up with that many times the pixel samples of
+// one frame (see setFramesPerLaunch()); the last launch of a view is cut to
+// the frames left to max_frames. Convergence is tested between launches, so a
+// view stops at a multiple of frames_per_launch frames, which is 1 for the
+// finest -variance-threshold cutoff. Returns the total number of frames
+// rendered.
+template <typename SetView, typename Finish>
+size_t renderViews(VolumeScene &scene,
+                   const size_t n_views,
+                   const int max_frames,
+                   const float variance_threshold,
+                   const int frames_per_launch,
+                   SetView &&set_view,
+                   Finish &&finish)
+{
+  using clock = std::chrono::steady_clock;
+  struct Slot
+  {
+    bool active = false;
+    size_t view = 0;
+    int frames = 0;
+    int launches = 0;
+    ospray::cpp::Future future{nullptr};
+    clock::time_point submitted;
+    // set when the frame is first seen done
+    bool ready = false;
+    clock::time_point completed;
+  };
+
+  const int n_slots = scene.framebuffers.size();
+  std::vector<Slot> slots(n_slots);
+  WorkStealingQueue queue(n_views, n_slots);
+  size_t total_frames = 0;
+
+  auto render = [&](const int s) {
+    Slot &slot = slots[s];
+    const int frames = std::max(std::min(frames_per_launch, max_frames - slot.frames), 1);
+    slot.future = scene.framebuffers[s].renderFrame(scene.launchRenderer(frames), scene.cameras[s], scene.world);
+    slot.submitted = clock::now();
+    slot.ready = false;
+    slot.frames += frames;
+    ++slot.launches;
+    total_frames += frames;
+  };
+  auto start = [&](const int s) {
+    Slot &slot = slots[s];
+    slot.active = queue.next(s, slot.view);
+    if (!slot.active) {
+      return;
+    }
+    set_view(s, slot.view);
+    scene.framebuffers[s].clear();
+    slot.frames = 0;
+    slot.launches = 0;
+    render(s);
+  };
+
+  // stamps the frames that completed since the last poll, so the traced
+  // frame times do not include the time spent handling other slots
+  auto poll = [&]() {
+    for (auto &slot : slots) {
+      if (slot.active && !slot.ready && slot.future.isReady()) {
+        slot.ready = true;
+        slot.completed = clock::now();
+      }
+    }
+  };
+
+  for (int s = 0; s < n_slots; ++s) {
+    start(s);
+  }
+  while (true) {
+    poll();
+    int n_active = 0;
+    bool progressed = false;
+    for (int s = 0; s < n_slots; ++s) {
+      Slot &slot = slots[s];
+      if (!slot.active) {
+        continue;
+      }
+      if (!slot.ready) {
+        ++n_active;
+        continue;
+      }
+      progressed = true;
+      Tracer::instance().record("frame", slot.submitted, slot.completed, TRACE_RENDER_SLOT_TID + s);
+      const bool converged = view_converged(scene.framebuffers[s], slot.launches, variance_threshold);
+      if (slot.frames < max_frames && !converged) {
+        render(s);
+      } else {
+        finish(s, slot.view, slot.frames);
+        start(s);
+      }
+      n_active += slot.active;
+      poll();
+    }
+    if (n_active == 0) {
+      break;
+    }
+    // nothing finished in this pass, poll again shortly instead of spinning;
+    // blocking on one frame would stamp the others late
+    if (!progressed) {
+      std::this_thread::sleep_for(RENDER_POLL_INTERVAL);
+    }
+  }
+  return total_frames;
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#include "ospray/ospray_cpp.h"
+#include "rkcommon/math/vec.h"
+
+#include "load_raw.h"
+#include "make_ospvolume.h"
+#include "make_tf.h"
+#include "trace.h"
+
+using namespace rkcommon::math;
+
+// samples per pixel of one accumulated frame
+const int SCENE_PIXEL_SAMPLES = 10;
+
+// The OSPRay objects needed to render a volume time series. Everything is
+// built once for the first timestep; setVolume() then only swaps the voxel
+// data of the volume and re-commits the objects that depend on it.
+//
+// The scene holds a ring of framebuffers, each with its own camera, so that
+// several views can be in flight at once.
+class VolumeScene
+{
+ public:
+  VolumeScene(const Volume &volume,
+              const vec2i &imgSize,
+              const std::string &colormap,
+              const vec2f &range,
+              const bool track_variance = false,
+              const int n_framebuffers = 1);
+
+  void setVolume(const Volume &volume);
+  // Renders the samples of `frames` accumulated frames in every
+  // renderFrame(), so small images pay the per-frame launch cost once.
+  // This only batches the frames of one view: OSPRay 2 renders one camera
+  // per renderFrame(), imageStart/imageEnd crop that camera's image plane
+  // but cannot place several views as tiles of one framebuffer. Launches of
+  // different views overlap through the framebuffer ring instead.
+  void setFramesPerLaunch(const int frames);
+  // The renderer for a launch of `frames` frames: `renderer` for a full
+  // launch, one with fewer samples for a shorter last launch of a view
+  ospray::cpp::Renderer &launchRenderer(const int frames);
+
+  // the volume whose voxels are shared with osp_volume
+  Volume volume;
+
+  ospray::cpp::TransferFunction transfer_function;
+  ospray::cpp::Volume osp_volume;
+  ospray::cpp::VolumetricModel volume_model;
+  ospray::cpp::Group group;
+  ospray::cpp::Instance instance;
+  ospray::cpp::Light light;
+  ospray::cpp::World world;
+  ospray::cpp::Renderer renderer;
+  // one camera per framebuffer, only its view parameters change per image
+  std::vector<ospray::cpp::FrameBuffer> framebuffers;
+  std::vector<ospray::cpp::Camera> cameras;
+
+ private:
+  void setupRenderer(ospray::cpp::Renderer &r, const int frames);
+
+  int frames_per_launch = 1;
+  std::map<int, ospray::cpp::Renderer> short_launch_renderers;
+};
+
+VolumeScene::VolumeScene(const Volume &volume,
+                         const vec2i &imgSize,
+                         const std::string &colormap,
+                         const vec2f &range,
+                         const bool track_variance,
+                         const int n_framebuffers)
+    : volume(volume),
+      transfer_function(makeTransferFunction(colormap, range)),
+      osp_volume(createStructuredVolume(volume)),
+      volume_model(osp_volume),
+      instance(group),
+      light("ambient"),
+      renderer("scivis")
+{
+  TraceScope scope("scene_build");
+  volume_model.setParam("transferFunction", transfer_function);
+  volume_model.commit();
+  // put the model into a group (collection of models)
+  group.setParam("volume", ospray::cpp::CopiedData(volume_model));
+  group.commit();
+  // put the group into an instance (give the group a world transform)
+  instance.commit();
+
+  // put the instance in the world
+  world.setParam("instance", ospray::cpp::CopiedData(instance));
+
+  // setup light for Ambient Occlusion
+  light.commit();
+
+  world.setParam("light", ospray::cpp::CopiedData(light));
+  world.commit();
+
+  // Scientific Visualization renderer, callers may override the parameters
+  setupRenderer(renderer, 1);
+
+  const int channels =
+      OSP_FB_COLOR | OSP_FB_ACCUM | (track_variance ? OSP_FB_VARIANCE : 0);
+  for (int i = 0; i < n_framebuffers; ++i) {
+    framebuffers.emplace_back(imgSize.x, imgSize.y, OSP_FB_SRGBA, channels);
+    framebuffers.back().clear();
+
+    cameras.emplace_back("perspective");
+    cameras.back().setParam("aspect", imgSize.x / (float)imgSize.y);
+    cameras.back().commit();
+  }
+}
+
+void VolumeScene::setVolume(const Volume &volume)
+{
+  setStructuredVolumeData(osp_volume, volume);
+  // the previous voxels can only be released once OSPRay no longer uses them
+  this->volume = volume;
+
+  // the acceleration structures above the volume have to be rebuilt
+  TraceScope scope("world_commit");
+  volume_model.commit();
+  group.commit();
+  instance.commit();
+  world.commit();
+}
+
+void VolumeScene::setupRenderer(ospray::cpp::Renderer &r, const int frames)
+{
+  r.setParam("aoSamples", 0);
+  r.setParam("pixelSamples", SCENE_PIXEL_SAMPLES * std::max(frames, 1));
+  r.setParam("backgroundColor", 1.0f); // white, transparent
+  r.commit();
+}
+
+void VolumeScene::setFramesPerLaunch(const int frames)
+{
+  frames_per_launch = std::max(frames, 1);
+  renderer.setParam("pixelSamples", SCENE_PIXEL_SAMPLES * frames_per_launch);
+  renderer.commit();
+}
+
+ospray::cpp::Renderer &VolumeScene::launchRenderer(const int frames)
+{
+  if (frames >= frames_per_launch) {
+    return renderer;
+  }
+  auto r = short_launch_renderers.find(frames);
+  if (r == short_launch_renderers.end()) {
+    r = short_launch_renderers.emplace(frames, ospray::cpp::Renderer("scivis")).first;
+    setupRenderer(r->second, frames);
+  }
+  return r->second;
+}
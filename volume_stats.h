@@ -0,0 +1,357 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define VOLUME_STATS_X86 1
+#include <immintrin.h>
+#endif
+
+#include "rkcommon/math/vec.h"
+#include "rkcommon/tasking/parallel_for.h"
+
+using namespace rkcommon::math;
+
+// The histogram bins are the same for every volume: a voxel falls into the
+// bin of the top 16 bits of its order preserving float key (sign, exponent
+// and 7 mantissa bits). A bin spans less than 1% of its values, and
+// histograms of different volumes merge exactly by adding their counts.
+// Bins further apart than the data are never touched, so a histogram only
+// keeps its non-empty bins.
+const int VOLUME_HISTOGRAM_KEY_SHIFT = 16;
+const int VOLUME_HISTOGRAM_BINS = 1 << (32 - VOLUME_HISTOGRAM_KEY_SHIFT);
+
+struct HistogramBin {
+    uint32_t bin;
+    uint32_t reserved;
+    uint64_t count;
+};
+
+// Summary of the voxel values of a volume, the histogram holds the non-empty
+// bins in increasing order of value. NaN voxels are not counted.
+struct VolumeStats {
+    vec2f range{0.f};
+    double mean = 0.0;
+    std::vector<HistogramBin> histogram;
+};
+
+// Unsigned key ordered like the float values, negative values are flipped
+inline uint32_t float_order_key(const float x)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    return (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+}
+
+inline float order_key_float(const uint32_t key)
+{
+    const uint32_t bits = (key & 0x80000000u) ? key & 0x7fffffffu : ~key;
+    float x;
+    std::memcpy(&x, &bits, sizeof(x));
+    return x;
+}
+
+inline uint32_t histogram_bin(const float x)
+{
+    return float_order_key(x) >> VOLUME_HISTOGRAM_KEY_SHIFT;
+}
+
+// smallest and largest value of a bin
+inline vec2f histogram_bin_range(const uint32_t bin)
+{
+    const uint32_t key = bin << VOLUME_HISTOGRAM_KEY_SHIFT;
+    return vec2f(order_key_float(key),
+                 order_key_float(key | ((1u << VOLUME_HISTOGRAM_KEY_SHIFT) - 1)));
+}
+
+// Non-empty bins of a dense histogram
+template <typename Count>
+std::vector<HistogramBin> sparse_histogram(const std::vector<Count> &counts)
+{
+    std::vector<HistogramBin> histogram;
+    for (size_t b = 0; b < counts.size(); ++b) {
+        if (counts[b] > 0) {
+            histogram.push_back(HistogramBin{uint32_t(b), 0, uint64_t(counts[b])});
+        }
+    }
+    return histogram;
+}
+
+// IEEE 754 binary16 to float
+inline float half_to_float(const uint16_t h)
+{
+    const uint32_t sign = uint32_t(h & 0x8000) << 16;
+    uint32_t exponent = (h >> 10) & 0x1f;
+    uint32_t mantissa = h & 0x3ff;
+    uint32_t bits = 0;
+    if (exponent == 0x1f) {
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    } else if (exponent != 0) {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    } else if (mantissa != 0) {
+        // subnormal, renormalize
+        exponent = 113;
+        while (!(mantissa & 0x400)) {
+            mantissa <<= 1;
+            --exponent;
+        }
+        bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+    } else {
+        bits = sign;
+    }
+    float f;
+    std::memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+// voxel to float conversions for compute_volume_stats()
+struct AsFloat {
+    template <typename T>
+    float operator()(const T x) const
+    {
+        return float(x);
+    }
+};
+
+struct HalfToFloat {
+    float operator()(const uint16_t x) const
+    {
+        return half_to_float(x);
+    }
+};
+
+struct MinMaxSum {
+    float min = std::numeric_limits<float>::infinity();
+    float max = -std::numeric_limits<float>::infinity();
+    double sum = 0.0;
+};
+
+// NaN voxels are skipped by the min/max (they still poison the mean)
+template <typename T, typename ToFloat>
+MinMaxSum minmaxsum_scalar(const T *v, const size_t n, ToFloat to_float)
+{
+    MinMaxSum r;
+    for (size_t i = 0; i < n; ++i) {
+        const float x = to_float(v[i]);
+        r.min = x < r.min ? x : r.min;
+        r.max = x > r.max ? x : r.max;
+        r.sum += x;
+    }
+    return r;
+}
+
+#ifdef VOLUME_STATS_X86
+// Partial sums are kept in float lanes for at most this many voxels before
+// they are folded into the double total, which bounds the rounding error.
+const size_t SIMD_SUM_BLOCK = 4096;
+
+__attribute__((target("avx2"))) inline MinMaxSum minmaxsum_avx2(const float *v,
+                                                                 const size_t n)
+{
+    __m256 lo = _mm256_set1_ps(std::numeric_limits<float>::infinity());
+    __m256 hi = _mm256_set1_ps(-std::numeric_limits<float>::infinity());
+    double sum = 0.0;
+    const size_t n8 = n & ~size_t(7);
+    for (size_t block = 0; block < n8; block += SIMD_SUM_BLOCK) {
+        const size_t end = std::min(block + SIMD_SUM_BLOCK, n8);
+        __m256 acc = _mm256_setzero_ps();
+        for (size_t i = block; i < end; i += 8) {
+            const __m256 x = _mm256_loadu_ps(v + i);
+            // x first, so NaN voxels keep the running value
+            lo = _mm256_min_ps(x, lo);
+            hi = _mm256_max_ps(x, hi);
+            acc = _mm256_add_ps(acc, x);
+        }
+        alignas(32) float lanes[8];
+        _mm256_store_ps(lanes, acc);
+        for (int k = 0; k < 8; ++k) {
+            sum += lanes[k];
+        }
+    }
+
+    alignas(32) float lo_lanes[8], hi_lanes[8];
+    _mm256_store_ps(lo_lanes, lo);
+    _mm256_store_ps(hi_lanes, hi);
+    MinMaxSum r = minmaxsum_scalar(v + n8, n - n8, AsFloat());
+    for (int k = 0; k < 8; ++k) {
+        r.min = std::min(r.min, lo_lanes[k]);
+        r.max = std::max(r.max, hi_lanes[k]);
+    }
+    r.sum += sum;
+    return r;
+}
+
+__attribute__((target("avx512f"))) inline MinMaxSum minmaxsum_avx512(const float *v,
+                                                                      const size_t n)
+{
+    __m512 lo = _mm512_set1_ps(std::numeric_limits<float>::infinity());
+    __m512 hi = _mm512_set1_ps(-std::numeric_limits<float>::infinity());
+    double sum = 0.0;
+    const size_t n16 = n & ~size_t(15);
+    for (size_t block = 0; block < n16; block += SIMD_SUM_BLOCK) {
+        const size_t end = std::min(block + SIMD_SUM_BLOCK, n16);
+        __m512 acc = _mm512_setzero_ps();
+        for (size_t i = block; i < end; i += 16) {
+            const __m512 x = _mm512_loadu_ps(v + i);
+            lo = _mm512_min_ps(x, lo);
+            hi = _mm512_max_ps(x, hi);
+            acc = _mm512_add_ps(acc, x);
+        }
+        sum += _mm512_reduce_add_ps(acc);
+    }
+
+    MinMaxSum r = minmaxsum_scalar(v + n16, n - n16, AsFloat());
+    r.min = std::min(r.min, _mm512_reduce_min_ps(lo));
+    r.max = std::max(r.max, _mm512_reduce_max_ps(hi));
+    r.sum += sum;
+    return r;
+}
+#endif
+
+// float voxels use the widest vector unit of the CPU we run on, whatever the
+// flags the binary was built with
+inline MinMaxSum minmaxsum(const float *v, const size_t n, AsFloat)
+{
+#ifdef VOLUME_STATS_X86
+    static const bool has_avx512 = __builtin_cpu_supports("avx512f");
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    if (has_avx512) {
+        return minmaxsum_avx512(v, n);
+    }
+    if (has_avx2) {
+        return minmaxsum_avx2(v, n);
+    }
+#endif
+    return minmaxsum_scalar(v, n, AsFloat());
+}
+
+template <typename T, typename ToFloat>
+MinMaxSum minmaxsum(const T *v, const size_t n, ToFloat to_float)
+{
+    return minmaxsum_scalar(v, n, to_float);
+}
+
+// Voxels per chunk of the threaded reduction, large enough to amortize the
+// task overhead and small enough to balance across cores
+const size_t STATS_CHUNK = size_t(1) << 20;
+// Voxels reduced at a time within a chunk, small enough that the histogram
+// pass reads them back from L1
+const size_t STATS_BLOCK = 4096;
+// Upper bound on the tasks of a reduction, each keeps a dense histogram
+const size_t STATS_MAX_TASKS = 64;
+
+// Computes min, max, mean and the histogram of n voxels, converted with
+// to_float, in one pass over memory. The bins do not depend on the range, so
+// every block of voxels goes through the min/max/sum kernel and straight on
+// into the histogram while it is still in cache. Contiguous groups of chunks
+// are reduced in parallel and their partial results summed.
+template <typename T, typename ToFloat>
+VolumeStats compute_volume_stats(const T *v, const size_t n, ToFloat to_float)
+{
+    VolumeStats stats;
+    if (n == 0) {
+        return stats;
+    }
+    const size_t n_chunks = (n + STATS_CHUNK - 1) / STATS_CHUNK;
+    const size_t n_tasks = std::min(n_chunks, STATS_MAX_TASKS);
+
+    std::vector<MinMaxSum> partial(n_tasks);
+    // a task covers fewer than 2^32 voxels unless the volume has over 2^38
+    std::vector<uint32_t> task_histograms(n_tasks * VOLUME_HISTOGRAM_BINS, 0);
+    rkcommon::tasking::parallel_for(n_tasks, [&](const size_t t) {
+        const size_t begin = std::min(n_chunks * t / n_tasks * STATS_CHUNK, n);
+        const size_t end = std::min(n_chunks * (t + 1) / n_tasks * STATS_CHUNK, n);
+        uint32_t *hist = &task_histograms[t * VOLUME_HISTOGRAM_BINS];
+        MinMaxSum &r = partial[t];
+        for (size_t block = begin; block < end; block += STATS_BLOCK) {
+            const size_t count = std::min(STATS_BLOCK, end - block);
+            const MinMaxSum b = minmaxsum(v + block, count, to_float);
+            r.min = std::min(r.min, b.min);
+            r.max = std::max(r.max, b.max);
+            r.sum += b.sum;
+            for (size_t i = block; i < block + count; ++i) {
+                const float x = to_float(v[i]);
+                hist[histogram_bin(x)] += x == x;
+            }
+        }
+    });
+    MinMaxSum total;
+    for (const auto &p : partial) {
+        total.min = std::min(total.min, p.min);
+        total.max = std::max(total.max, p.max);
+        total.sum += p.sum;
+    }
+    stats.range = vec2f(total.min, total.max);
+    stats.mean = total.sum / double(n);
+
+    std::vector<uint64_t> counts(VOLUME_HISTOGRAM_BINS, 0);
+    for (size_t t = 0; t < n_tasks; ++t) {
+        for (int b = 0; b < VOLUME_HISTOGRAM_BINS; ++b) {
+            counts[b] += task_histograms[t * VOLUME_HISTOGRAM_BINS + b];
+        }
+    }
+    stats.histogram = sparse_histogram(counts);
+    return stats;
+}
+
+// Combines the statistics of several volumes, e.g. the timesteps of a series.
+// The bins are shared, so the merged histogram is exact.
+VolumeStats merge_volume_stats(const std::vector<VolumeStats> &stats)
+{
+    VolumeStats merged;
+    merged.range = vec2f(std::numeric_limits<float>::infinity(),
+                         -std::numeric_limits<float>::infinity());
+    std::vector<uint64_t> counts(VOLUME_HISTOGRAM_BINS, 0);
+    double total = 0.0;
+    double sum = 0.0;
+    for (const auto &s : stats) {
+        merged.range.x = std::min(merged.range.x, s.range.x);
+        merged.range.y = std::max(merged.range.y, s.range.y);
+        uint64_t n = 0;
+        for (const auto &b : s.histogram) {
+            counts[b.bin] += b.count;
+            n += b.count;
+        }
+        total += double(n);
+        sum += s.mean * double(n);
+    }
+    merged.mean = total > 0.0 ? sum / total : 0.0;
+    merged.histogram = sparse_histogram(counts);
+    return merged;
+}
+
+// Value below which the fraction p (0-1) of the voxels lies, interpolated
+// linearly within the histogram bin that crosses p and clamped to the range
+float histogram_percentile(const VolumeStats &stats, const float p)
+{
+    uint64_t total = 0;
+    for (const auto &b : stats.histogram) {
+        total += b.count;
+    }
+    if (total == 0) {
+        return stats.range.x;
+    }
+    const double target = std::min(std::max(double(p), 0.0), 1.0) * total;
+    double cumulative = 0.0;
+    for (const auto &b : stats.histogram) {
+        const double count = double(b.count);
+        if (cumulative + count >= target) {
+            const double t = (target - cumulative) / count;
+            const vec2f values = histogram_bin_range(b.bin);
+            const double value = values.x + t * (double(values.y) - values.x);
+            return float(std::min(std::max(value, double(stats.range.x)), double(stats.range.y)));
+        }
+        cumulative += count;
+    }
+    return stats.range.y;
+}
+
+// Transfer function range clipping the lo and hi percentiles (0-100)
+vec2f percentile_range(const VolumeStats &stats, const float lo, const float hi)
+{
+    return vec2f(histogram_percentile(stats, lo / 100.f), histogram_percentile(stats, hi / 100.f));
+}
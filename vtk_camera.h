@@ -0,0 +1,202 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+#include "rkcommon/math/vec.h"
+
+using namespace rkcommon::math;
+
+// The subset of vtkCamera used to derive views from (elevation, azimuth,
+// roll, zoom) parameters, without VTK. It follows the vtkCamera of VTK 9:
+// angles are in degrees, rotations are about the focal point, and the view
+// up is normalized but only orthogonalized by orthogonalizeViewUp().
+//
+// Like vtkCamera it keeps the view up its view transform was last computed
+// with apart from the view up itself. elevation() computes the transform
+// with the rotated view up but then restores the view up, so the horizontal
+// axis of a following elevation() and the result of orthogonalizeViewUp()
+// follow the rotation while azimuth() still turns about the old view up.
+// Everything is computed in double like VTK and nothing is allocated.
+// tests/test_vtk_camera.cpp checks it against vtkCamera.
+class VtkCamera
+{
+ public:
+  void setPosition(const vec3d &p);
+  void setFocalPoint(const vec3d &p);
+  void setViewUp(const vec3d &up);
+  void setViewAngle(const double angle);
+
+  // rotate the position about the horizontal axis of the view
+  void elevation(const double angle);
+  // rotate the position about the view up vector
+  void azimuth(const double angle);
+  // rotate the view up vector about the direction of projection
+  void roll(const double angle);
+  // perspective zoom, narrows the view angle
+  void zoom(const double amount);
+  void orthogonalizeViewUp();
+
+  vec3d position() const
+  {
+    return pos;
+  }
+  vec3d focalPoint() const
+  {
+    return focal;
+  }
+  vec3d viewUp() const
+  {
+    return up;
+  }
+  double viewAngle() const
+  {
+    return view_angle;
+  }
+
+ private:
+  // rows 0 and 1 of vtkCamera's view transform (vtkPerspectiveTransform::SetupCamera)
+  vec3d viewSideways() const;
+  vec3d orthoViewUp() const;
+
+  // vtkCamera defaults
+  vec3d pos{0.0, 0.0, 1.0};
+  vec3d focal{0.0, 0.0, 0.0};
+  vec3d up{0.0, 1.0, 0.0};
+  double view_angle = 30.0;
+  // the view up of the view transform, vtkCamera::ComputeViewTransform()
+  vec3d transform_up{0.0, 1.0, 0.0};
+};
+
+// vtkMath::Normalize, zero vectors are left as they are
+inline vec3d vtk_normalize(const vec3d &v)
+{
+  const double len = length(v);
+  return len != 0.0 ? v / len : v;
+}
+
+// v rotated by angle degrees about axis, as vtkTransform::RotateWXYZ builds
+// the rotation from a quaternion
+inline vec3d vtk_rotate_wxyz(const vec3d &v, const double angle, const vec3d &axis)
+{
+  const double len = length(axis);
+  if (angle == 0.0 || len == 0.0) {
+    return v;
+  }
+  const double half = 0.5 * angle * M_PI / 180.0;
+  const double w = std::cos(half);
+  const double f = std::sin(half) / len;
+  const double x = axis.x * f, y = axis.y * f, z = axis.z * f;
+
+  const double ww = w * w, wx = w * x, wy = w * y, wz = w * z;
+  const double xx = x * x, yy = y * y, zz = z * z;
+  const double xy = x * y, xz = x * z, yz = y * z;
+
+  const vec3d row0(ww + xx - yy - zz, 2.0 * (xy - wz), 2.0 * (xz + wy));
+  const vec3d row1(2.0 * (xy + wz), ww - xx + yy - zz, 2.0 * (yz - wx));
+  const vec3d row2(2.0 * (xz - wy), 2.0 * (yz + wx), ww - xx - yy + zz);
+  return vec3d(dot(row0, v), dot(row1, v), dot(row2, v));
+}
+
+// the setters recompute the view transform like vtkCamera's, which return
+// early on unchanged values
+void VtkCamera::setPosition(const vec3d &p)
+{
+  if (p == pos) {
+    return;
+  }
+  pos = p;
+  transform_up = up;
+}
+
+void VtkCamera::setFocalPoint(const vec3d &p)
+{
+  if (p == focal) {
+    return;
+  }
+  focal = p;
+  transform_up = up;
+}
+
+void VtkCamera::setViewUp(const vec3d &v)
+{
+  const double len = length(v);
+  const vec3d normalized = len != 0.0 ? v / len : vec3d(0.0, 1.0, 0.0);
+  if (normalized == up) {
+    return;
+  }
+  up = normalized;
+  transform_up = up;
+}
+
+void VtkCamera::setViewAngle(const double angle)
+{
+  view_angle = std::min(std::max(angle, 0.00000001), 179.0);
+}
+
+vec3d VtkCamera::viewSideways() const
+{
+  const vec3d view_plane_normal = vtk_normalize(pos - focal);
+  return vtk_normalize(cross(transform_up, view_plane_normal));
+}
+
+vec3d VtkCamera::orthoViewUp() const
+{
+  const vec3d view_plane_normal = vtk_normalize(pos - focal);
+  return cross(view_plane_normal, viewSideways());
+}
+
+void VtkCamera::elevation(const double angle)
+{
+  const vec3d axis = -viewSideways();
+  // the view transform is computed with the rotated view up, which avoids a
+  // degenerate cross product near the poles, then the view up is restored
+  const vec3d saved_up = up;
+  up = vtk_rotate_wxyz(up, angle, axis);
+  setPosition(focal + vtk_rotate_wxyz(pos - focal, angle, axis));
+  up = saved_up;
+}
+
+void VtkCamera::azimuth(const double angle)
+{
+  setPosition(focal + vtk_rotate_wxyz(pos - focal, angle, up));
+}
+
+void VtkCamera::roll(const double angle)
+{
+  const vec3d direction_of_projection = vtk_normalize(focal - pos);
+  setViewUp(vtk_rotate_wxyz(up, angle, direction_of_projection));
+}
+
+void VtkCamera::zoom(const double amount)
+{
+  if (amount <= 0.0) {
+    return;
+  }
+  setViewAngle(view_angle / amount);
+}
+
+void VtkCamera::orthogonalizeViewUp()
+{
+  up = orthoViewUp();
+}
+
+// The camera of a view given by the (elevation, azimuth, roll, zoom) of
+// view_param, looking at a volume with the given center and upper corner
+// from below as the view files of the VTK pipeline set it up
+VtkCamera vtk_view_camera(const vec3d &center, const vec3d &upper, const float *view_param)
+{
+  VtkCamera camera;
+  camera.setPosition(vec3d(center.x, 2 * -(upper.y - center.y), center.z));
+  camera.setFocalPoint(center);
+  camera.setViewUp(vec3d(1, 1, 1));
+  camera.setViewAngle(75.);
+
+  camera.elevation(-85.f);
+
+  camera.elevation(view_param[0]);
+  camera.azimuth(view_param[1]);
+  camera.roll(view_param[2]);
+  camera.zoom(view_param[3]);
+  return camera;
+}